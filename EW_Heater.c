@@ -14,7 +14,9 @@
 * Includes
 *******************************************************************************/
 #include "i2c.h"
-#include "eeprom_ext.h"
+#include "storage.h"
+#include "settings.h"
+#include "logger.h"
 #include "adc.h"
 #include "ssd.h"
 #include "port.h"
@@ -23,7 +25,16 @@
 #include "heatLED.h"
 #include "sw.h"
 #include "tempsensor.h"
+#include "supply.h"
+#include "energy.h"
 #include "ext_int.h"
+#include "pwrmgr.h"
+#include "tstamp.h"
+#include "trace.h"
+#include "usart.h"
+#include "telem.h"
+#include "modbus.h"
+#include "bench.h"
 #include "EW_Heater.h"
 #include "sch.h"
 
@@ -34,37 +45,193 @@
  * static unsigned char (DTemp) is the (Set/Desired) temperature used by:
  *          - SSD_UpdateDisp_Task()
  *          - Temp_Control_Task()
- *          - SetTemp_Task()
+ *          - Buttons_Event()
  * static DISP_MOD_T (OP_mode) is the current operating mode used by:
- *          - SetTemp_Task()
+ *          - Buttons_Event()
  *          - SSD_UpdateDisp_Task()
  * static PWR_MOD_T (pwr_mode) POWER_OFF = MCU was or currently in sleep mode
+ *          - logger_suspend()
+ *          - pwr_fail()
+ * static unsigned short (avg_tmp) is the average of the last k temperature readings
+ *          - Temp_Control_Task()
+ *          - Log_Task()
+ * static unsigned int (disp_idle) counts the display updates since the last button press
+ *          - SSD_UpdateDisp_Task()
+ *          - Buttons_Event()
+ *          - display_resume()
+ * static unsigned short (tmp) the last k temperature readings, (tmp_ind) the
+ * next reading index, (temp_cont_mode) the control state and (heat_hyst /
+ * cool_hyst) the distance of the heat / cool thresholds from the set
+ * temperature used by:
+ *          - Temp_Control_Task()
+ *          - control_resume()
+ * static unsigned int (resume_ts) the time of every phase of the last resume
+ *          - resume_mark()
+ * static DIAG_PAGE_T (diag_page) the page shown in the diagnostics mode
+ *          - Buttons_Event()
+ *          - diag_render()
+ * static adaptive rate state: (sense_task / control_task) the scheduler
+ * indexes of the tasks whose period changes, (ctrl_period) the current
+ * control period in ms, (blink_runs) the control runs per heat LED toggle
+ * at that period, (rate_time / rate_ref) the time and average
+ * temperature at the start of the slope window used by:
+ *          - rate_fast() / rate_update()
+ *          - Temp_Control_Task()
+ *          - tasks_creation()
+ * static calibration state: (cal_point) the point being entered, (cal_ref) the
+ * reference temperatures, (cal_raw) the captured readings, (cal_filt) the
+ * filtered raw reading (1 << TEMP_CAL_RAW_SHIFT counts), (cal_skip) the
+ * buttons whose release ends a long press, (cal_code / cal_name) the message
+ * shown and for how many display updates:
+ *          - cal_start() / cal_capture() / cal_buttons()
  *          - SSD_UpdateDisp_Task()
  *          - Temp_Control_Task()
 -*------------------------------------------------------------------*/ 
 static unsigned char DTemp = INITIAL_TEMP;
+static unsigned short avg_tmp = 0;
 static PWR_MOD_T pwr_mode = POWER_OFF;
 static DISP_MOD_T OP_mode = TEMP_DISP_MODE ;
+static unsigned int disp_idle = 0;
+static unsigned short tmp[TEMP_READINGS_AVG];
+static unsigned char tmp_ind = 0;
+static TEMP_CONT_T temp_cont_mode = NO_ENOUGH_READINGS;
+static unsigned char heat_hyst = TEMP_ERROR_VAL;
+static unsigned char cool_hyst = TEMP_ERROR_VAL;
+static uint16_t resume_base = 0;
+static uint16_t resume_ts[RESUME_PH_NUM];
+static DIAG_PAGE_T diag_page = DIAG_PG_LOAD;
+static unsigned char sense_task = SCH_MAX_TASKS;
+static unsigned char control_task = SCH_MAX_TASKS;
+static unsigned char blink_runs = HEAT_LED_BLINK_TIME / TEMP_CONTROL_TASK_PERIOD;
+#if TEMP_ADAPT_ENABLE
+static unsigned int ctrl_period = TEMP_CONTROL_TASK_PERIOD;
+static unsigned int rate_time = 0;
+static unsigned short rate_ref = 0;
+#endif
+static unsigned char cal_point = 0;
+static unsigned char cal_ref[2];
+static unsigned int cal_raw[2];
+static unsigned int cal_filt = 0;
+static unsigned char cal_skip = 0;
+static unsigned char cal_code = 0;
+static unsigned char cal_name = 0;
 
 /******************************************************************************
 * Functions
 *******************************************************************************/
+/*------------------------------------------------------------------*
+ * overruns_sum()
+ * This function gets the overruns of all the tasks (wraps at 256).
+-*------------------------------------------------------------------*/
+static unsigned char overruns_sum(void)
+{
+    unsigned char ovr = 0;
+    unsigned char i;
+
+    for(i = 0 ; i < SCH_MAX_TASKS ; i++)
+    {
+        ovr += SCH_Get_Overruns(i);
+    }
+    return ovr;
+}
+
+/*------------------------------------------------------------------*
+ * diag_tenths()
+ * This function shows a value given in tenths with the decimal point while
+ * it fits the display, then in whole units.
+-*------------------------------------------------------------------*/
+static void diag_tenths(unsigned long tenths)
+{
+    if(tenths < 100)
+    {
+        ssd_show_number((unsigned int)tenths, 1);
+    }
+    else
+    {
+        tenths /= 10;
+        ssd_show_number((tenths > 0xFFFF) ? 0xFFFF : (unsigned int)tenths, SSD_NO_DP);
+    }
+}
+
+/*------------------------------------------------------------------*
+ * diag_render()
+ * This function renders the current diagnostics page, its name (d1, d2 ..)
+ * while a button is held and for DIAG_NAME_TIME after it, then its value.
+ * Decimal values that do not fit are shown as dashes, counters and raw
+ * readings are shown in hexadecimal (see DIAG_PAGE_T).
+-*------------------------------------------------------------------*/
+static void diag_render(void)
+{
+    unsigned int val = 0;
+    unsigned char dp = SSD_NO_DP;
+    unsigned char i;
+
+    if(disp_idle < DIAG_NAME_TICKS)
+    {
+        ssd_show_hex(0xD0 + diag_page + 1);
+        return;
+    }
+    switch(diag_page)
+    {
+        case DIAG_PG_LOAD:          val = SCH_Get_Load();                   break;
+        case DIAG_PG_ISR_LOAD:      val = SCH_Get_ISR_Load();               break;
+        case DIAG_PG_PEAK:          val = SCH_Get_Peak_Busy(); dp = 1;      break;
+        case DIAG_PG_SCH_ERROR:
+            ssd_show_code(0xE, SCH_Get_Error());
+            return;
+        case DIAG_PG_OVERRUNS:
+            ssd_show_hex(overruns_sum());
+            return;
+        case DIAG_PG_MAX_TASK:
+            for(i = 0 ; i < SCH_MAX_TASKS ; i++)
+            {
+                if(SCH_Get_Max_Time(i) > val)
+                {
+                    val = SCH_Get_Max_Time(i);
+                }
+            }
+            dp = 1;
+            break;
+        case DIAG_PG_E2P_ERRORS:
+            val = storage_get_errors();
+            ssd_show_hex((val > 0xFF) ? 0xFF : (unsigned char)val);
+            return;
+        case DIAG_PG_ADC_TEMP:
+            ssd_show_hex((unsigned char)(temp_get_raw() >> 2));
+            return;
+        case DIAG_PG_ADC_SUPPLY:
+            ssd_show_hex((unsigned char)(supply_get() >> 2));
+            return;
+        case DIAG_PG_ENERGY_DAY:
+            diag_tenths(energy_get_day() / 100);
+            return;
+        case DIAG_PG_ENERGY_LIFE:
+            diag_tenths(energy_get_total() / 100000UL);
+            return;
+        default:                                                            break;
+    }
+    if(dp == 1)
+    {
+        val /= (100 / TSTAMP_US_PER_TICK);      // Time in 0.1ms
+    }
+    ssd_show_number(val, dp);
+}
+
 /*------------------------------------------------------------------*
  * SSD_UpdateDisp_Task()
- * This is the task responsible for operating the seven segments display.
- * A periodic function that is repeated every (n)ms for two displays
- * every display is refreshed every (2*n)ms. Where n represents the refresh 
- * period and can be changed from the config file. Two values are displayed
- * (Temperature Reading / Temperature Setting value). At temperature Setting
- * mode SSDs blinks every (m)s.Where m is the on/off time.
- * 
- * SSD_UpdateDisp_Task Explained:
- *      - state machine with two states 
- *          * 1st state is responsible for getting the value displayed for the right SSD 
- *            and operating according to the operation mode.
- *          * 2nd state is responsible for getting the value displayed for the left SSD 
- *            and operating according to the operation mode and updating the counter as it is the last SSD.
- *      - every state is responsible for the next state transition 
+ * This is the task responsible for the content of the seven segments display.
+ * The digits are multiplexed by the Timer 2 interrupt from the SSD frame
+ * buffer, this task only rewrites the frame buffer when the displayed value
+ * changes. Two values are displayed (Temperature Reading / Temperature
+ * Setting value). At temperature Setting mode SSDs blinks every (m)s.Where m
+ * is the on/off time, the blinking, the brightness and the blanking after
+ * SSD_BLANK_TIMEOUT minutes without a button press are applied by the SSD
+ * duty engine. The setting mode ends after TEMP_SET_TIMEOUT without a button
+ * press, it is timed here with the display idle count.
+ * In the diagnostics mode the selected page is rendered instead (see
+ * diag_render()) until DIAG_TIMEOUT without a button press, a sensor fault
+ * replaces the temperature reading by its code. In the calibration mode the
+ * reference temperature of the current point blinks until TEMP_CAL_TIMEOUT.
  * This function is called by:
  *                              tasks_creation
  *                              SCH_Dispatch_Tasks
@@ -72,73 +239,83 @@ static DISP_MOD_T OP_mode = TEMP_DISP_MODE ;
 -*------------------------------------------------------------------*/ 
 void SSD_UpdateDisp_Task(void)
 {  
-    static SSD_STATE_ET state = SSD1 ;
-    static unsigned char count = 0;
-    unsigned char val = 0 , mode;  // the value to display on the 2 SSD 
+    static unsigned int shown_val = 0xFFFF;   // nothing rendered yet
+    unsigned char val = 0 , mode;  // the value to display on the SSDs
     mode = get_op_mode();
+    
+    /* Time since the last button interaction, a held button keeps it at 0 */
+    if(sw_is_down(PLUS_SW_MSK | MINUS_SW_MSK))
+    {
+        disp_idle = 0;
+    }
+    else if(disp_idle < 0xFFFF)
+    {
+        disp_idle++;
+    }
+    
+    /* Leave the setting mode after TEMP_SET_TIMEOUT without interaction and save the set temperature */
+    if(mode == TEMP_SET_MODE && disp_idle >= TEMP_SET_TICKS)
+    {
+        mode = TEMP_DISP_MODE;
+        set_op_mode(mode);
+        settings_commit();
+    }
+    /* Leave the diagnostics mode after DIAG_TIMEOUT without interaction */
+    if(mode == DIAG_MODE && disp_idle >= DIAG_TICKS)
+    {
+        mode = TEMP_DISP_MODE;
+        set_op_mode(mode);
+    }
+    /* Drop the calibration after TEMP_CAL_TIMEOUT without interaction */
+    if(mode == CAL_MODE && disp_idle >= CAL_TICKS)
+    {
+        mode = TEMP_DISP_MODE;
+        set_op_mode(mode);
+    }
     val = (mode==TEMP_DISP_MODE)?get_temp():DTemp;    // Decide which value to display 
-    switch(state)
+    
+    /* Blank the display after a long time without a button press, any button wakes it */
+#if SSD_BLANK_TIMEOUT > 0
+    ssd_set_blank(disp_idle >= SSD_BLANK_TICKS);
+#endif
+    ssd_set_blink(mode == TEMP_SET_MODE || mode == CAL_MODE);
+    ssd_duty_tick();
+    
+    /* The diagnostics values change all the time, the page is rendered every period */
+    if(mode == DIAG_MODE)
     {
-        /* State to update the right SSD *************************************/
-        
-        case SSD1:
-            ssd_write_data(val%10);     // get the the right digit of the two digit number and send it to data port
-            /* Checking display mode (set temperature mode / current temperature reading) */
-            if(mode == TEMP_DISP_MODE)
-            {
-                /* current temperature reading mode */
-                ssd_en(SSD3_MSK);   // enable the third display on the board 
-            }
-            /* 
-             * Checking that the display mode is (set temperature mode) with the blinking count greater than the value 
-             * calculated by the task period and desired blinking rate and number of SSDs, so the SSD will turn off.
-             *  */
-            else if(mode == TEMP_SET_MODE && count > (SSD_BLINK_PERIOD/(SSD_TASK_PERIOD * SSD_NUM)))
-            {
-                ssd_off();      // turn off SSD
-            }
-            /* 
-             * The display must be in set temperature mode with the blinking count is less than the time given 
-             * so the SSD will turn on so that half of the count the SSDs are turned on and the other half they are off.
-             */
-            else
-            {
-                ssd_en(SSD3_MSK );  // turn on SSD
-            } 
-            state = SSD2;     // Move the state to the next SSD
-            
-            break;
-        /*********************************************************************/
-            
-            
-        /* State to update the second SSD ************************************/
-            
-        case SSD2:
-            ssd_write_data(val/10);     // get the the left digit of the two digit number and send it to data port.
-            /* Checking display mode */
-            if(mode == TEMP_DISP_MODE)
-            {
-                ssd_en(SSD2_MSK );
-            }
-            /* Checking display mode and count */
-            else if(mode == TEMP_SET_MODE && count > (SSD_BLINK_PERIOD/(SSD_TASK_PERIOD * SSD_NUM)))
-            {
-                ssd_off();       
-                count ++;               // update blinking counter.
-            }
-            else
-            {
-                ssd_en(SSD2_MSK );
-                count ++;               // update blinking counter.
-            }
-            state = SSD1;     // Move the state to the next SSD
-            /* Check if the counter Exceeded the on/off time interval */
-            if (count > (SSD_BLINK_PERIOD/(SSD_TASK_PERIOD)))    
-            {
-                count = 0;  // Reset the counter
-            }
-            break;
-        /*********************************************************************/
+        diag_render();
+        shown_val = 0xFFFF;     // Render the temperature again when leaving
+        return;
+    }
+    /* Calibration: C1 / C2 (or CE after rejected points) then the reference temperature */
+    if(mode == CAL_MODE)
+    {
+        if(cal_name > 0)
+        {
+            cal_name--;
+            ssd_show_hex(cal_code);
+        }
+        else
+        {
+            ssd_show_number(cal_ref[cal_point], SSD_NO_DP);
+        }
+        shown_val = 0xFFFF;
+        return;
+    }
+    /* A sensor fault is shown as F1 (reads low) / F2 (reads high) instead of a temperature */
+    if(mode == TEMP_DISP_MODE && temp_get_fault() != TEMP_FAULT_NONE)
+    {
+        ssd_show_code(0xF, temp_get_fault());
+        shown_val = 0xFFFF;
+        return;
+    }
+    
+    /* The frame buffer is left untouched while the value does not change */
+    if(val != shown_val)
+    {
+        ssd_show_number(val, SSD_NO_DP);
+        shown_val = val;
     }
 }
 
@@ -155,16 +332,82 @@ void Temp_Sense_Task(void)
     temp_update();    // Update the Temperature Readings
 }
 
+/*------------------------------------------------------------------*
+ * rate_fast()
+ * This function puts the sense and control tasks back at their configured
+ * periods and restarts the slope window, called on anything the control
+ * must follow closely (set temperature change, water draw, large error,
+ * wake up, sensor fault).
+-*------------------------------------------------------------------*/
+static void rate_fast(void)
+{
+#if TEMP_ADAPT_ENABLE
+    if(ctrl_period != TEMP_CONTROL_TASK_PERIOD)
+    {
+        ctrl_period = TEMP_CONTROL_TASK_PERIOD;
+        blink_runs = HEAT_LED_BLINK_TIME / TEMP_CONTROL_TASK_PERIOD;
+        SCH_Set_Period(sense_task, TEMP_SENSE_TASK_CREATION_PERIOD);
+        SCH_Set_Period(control_task, TEMP_CONTROL_TASK_CREATION_PERIOD);
+    }
+    rate_time = 0;
+    rate_ref = avg_tmp;
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * rate_update()
+ * This function adapts the sense and control rate to the tank, it is
+ * called by every control decision. The tasks slow down to
+ * TEMP_ADAPT_SLOW_PERIOD once the average stayed within TEMP_ADAPT_SLOPE
+ * for a whole TEMP_ADAPT_WINDOW near the set temperature, the averaging
+ * buffer then spans TEMP_READINGS_AVG slow periods. A reading well below
+ * the average (cold water coming in) or a large error goes back to full
+ * rate at once.
+-*------------------------------------------------------------------*/
+static void rate_update(void)
+{
+#if TEMP_ADAPT_ENABLE
+    unsigned short err = (avg_tmp > DTemp) ? avg_tmp - DTemp : DTemp - avg_tmp;
+    unsigned short slope = (avg_tmp > rate_ref) ? avg_tmp - rate_ref : rate_ref - avg_tmp;
+
+    if(err > TEMP_ADAPT_ERROR || get_temp() + TEMP_ADAPT_DRAW <= avg_tmp)
+    {
+        rate_fast();
+        return;
+    }
+    rate_time += ctrl_period;
+    if(rate_time < TEMP_ADAPT_WINDOW)
+    {
+        return;
+    }
+    if(slope > TEMP_ADAPT_SLOPE)
+    {
+        rate_fast();
+        return;
+    }
+    rate_time = 0;
+    rate_ref = avg_tmp;
+    if(ctrl_period != TEMP_ADAPT_SLOW_PERIOD)
+    {
+        ctrl_period = TEMP_ADAPT_SLOW_PERIOD;
+        blink_runs = HEAT_LED_BLINK_TIME / TEMP_ADAPT_SLOW_PERIOD;
+        SCH_Set_Period(sense_task, TEMP_ADAPT_SLOW_TICKS);
+        SCH_Set_Period(control_task, TEMP_ADAPT_SLOW_TICKS);
+    }
+#endif
+}
+
 /*------------------------------------------------------------------*
  * Temp_Control_Task()
  * This is the task responsible for controlling the temperature with the
  * (Heater / Cooler) based on the average k temperature reading and the set temperature.
  * A periodic function that is repeated every (n)ms, (n & k) can both be changed from
  * configuration file.
- * 5 degrees celsius error allowed for the temperature.
+ * Heating starts at (heat_hyst) degrees below the set temperature and cooling
+ * at (cool_hyst) degrees above it, both saved in the settings.
  * 
  * Temp_Control_Task Explained:
- *      - state machine with four states 
+ *      - state machine with five states 
  *          * NO_ENOUGH_READINGS * initial state takes no action until the average 
  *            temperature buffer is full.
  *          * TEMP_CONTROL_OFF * the state after NO_ENOUGH_READINGS state checks the 
@@ -176,37 +419,28 @@ void Temp_Sense_Task(void)
  *          * HEATER_ON_STATE * state is responsible of controlling the heat element
  *            and moving to the COOLER_ON_STATE when the temperature exceeds the
  *            allowed error and setting the temperature control mode.
+ *          * IDLE_STATE * (TEMP_DEADBAND) both elements are off, heating and
+ *            cooling stop here at the set temperature instead of switching to
+ *            the other element, it is left when a threshold is crossed.
  *      - every state is responsible for the next state transition
+ *      - a sensor fault (temp_get_fault()) or the calibration mode turns
+ *        both elements off and restarts from NO_ENOUGH_READINGS
+ *      - with TEMP_ADAPT_ENABLE the sense and control periods follow the
+ *        tank (see rate_update())
 -*------------------------------------------------------------------*/ 
 void Temp_Control_Task(void)
 {
     
-    static unsigned short tmp[10] , avg_tmp , cnt = 0;
-    static unsigned char ind = 0 ;
-    static TEMP_CONT_T temp_cont_mode = NO_ENOUGH_READINGS;
+    static unsigned short cnt = 0;
     unsigned short avg_ind = 0;
     
     
     
-    /*************************************************************************
-     * Checking the previous power mode if this is the first time for the 
-     * task to run after power on static variables must return to it's initial 
-     * positions 
-     *************************************************************************/
-    if(get_pwr_mode() == POWER_OFF)
-    {
-        ind = 0;
-        temp_cont_mode = NO_ENOUGH_READINGS;
-        set_pwr_mode(POWER_ON);
-    }
-    /*************************************************************************/
-    
-    
-    
     /* Getting the Average of the Temperature readings ***********************/
-    tmp[ind] = get_temp();  // Get current temperature reading
-    ind++;                  // Increase the buffer index
-    ind%=TEMP_READINGS_AVG; // Reset the buffer if it reaches the end of the buffer
+    tmp[tmp_ind] = get_temp();  // Get current temperature reading
+    tmp_ind++;                  // Increase the buffer index
+    tmp_ind%=TEMP_READINGS_AVG; // Reset the buffer if it reaches the end of the buffer
+    BENCH_BEGIN(BENCH_TEMP_AVG);
     avg_tmp = 0;            // Clear average readings value
     
         /* Add the buffer values to calculate the average to take a decision based on it */
@@ -215,6 +449,36 @@ void Temp_Control_Task(void)
         avg_tmp+=tmp[avg_ind];
     }
     avg_tmp /= TEMP_READINGS_AVG;   // Calculate the average of the readings
+    BENCH_END(BENCH_TEMP_AVG);
+    /*************************************************************************/
+    
+    
+    /* Calibration: the raw reading is filtered for the captured points ***/
+    if(get_op_mode() == CAL_MODE)
+    {
+        cal_filt = cal_filt - (cal_filt >> TEMP_CAL_RAW_SHIFT) + temp_get_raw();
+    }
+    
+    /* Sensor fault or calibration (the sensor is in a reference bath): no
+     * decision on a wrong reading, both elements are off *******************/
+    if(temp_get_fault() != TEMP_FAULT_NONE || get_op_mode() == CAL_MODE)
+    {
+        heater_off();
+        cooler_off();
+        heatLED_off();
+        tmp_ind = 0;                        // Refill the average with good readings
+        temp_cont_mode = NO_ENOUGH_READINGS;
+        rate_fast();
+        return;
+    }
+    /*************************************************************************/
+    
+    
+    /* Sense and control rate ************************************************/
+    if(temp_cont_mode != NO_ENOUGH_READINGS)
+    {
+        rate_update();
+    }
     /*************************************************************************/
     
     
@@ -225,7 +489,7 @@ void Temp_Control_Task(void)
         
         case NO_ENOUGH_READINGS:
             /* Checking if 10 readings in the buffer to start taking decision */
-            if(ind < TEMP_READINGS_AVG - 1){
+            if(tmp_ind < TEMP_READINGS_AVG - 1){
                 temp_cont_mode = NO_ENOUGH_READINGS ; }    // Did not reach the 10 temperature readings to make a decision
             else{
                 temp_cont_mode = TEMP_CONTROL_OFF;         // Buffer has 10 readings and can make a decision now
@@ -251,10 +515,19 @@ void Temp_Control_Task(void)
              * the retrieved temperature.
              */
             
+#if TEMP_DEADBAND
+            if( avg_tmp <= DTemp - heat_hyst) {
+                temp_cont_mode = HEATER_ON_STATE ; }    // Temperature is below the band go to heating mode
+            else if( avg_tmp >= DTemp + cool_hyst) {
+                temp_cont_mode = COOLER_ON_STATE ; }    // Temperature is above the band go to cooling mode
+            else{
+                temp_cont_mode = IDLE_STATE ; }         // Temperature is inside the band
+#else
             if( avg_tmp < DTemp) {
                 temp_cont_mode = HEATER_ON_STATE ; }    // Temperature is less than desired go to heating mode
             else{
                 temp_cont_mode = COOLER_ON_STATE ; }    // Temperature is more than desired go to cooling mode
+#endif
             heatLED_off();       // LED off             // Turn off Heat Element LED as it is not a heat or cool state
             break;
         /*********************************************************************/    
@@ -265,11 +538,19 @@ void Temp_Control_Task(void)
         case COOLER_ON_STATE:
             heater_off();                       // Heater off
             cooler_on();                        // Cooler on    
+#if TEMP_DEADBAND
+            /* Stop cooling at the set temperature */
+            if(avg_tmp <= DTemp)
+            {
+                temp_cont_mode = IDLE_STATE;        // Switch to idle mode
+            }
+#else
             /* Check if the temperature exceeded the error allowed if so switch to heating */
-            if(avg_tmp <= DTemp-TEMP_ERROR_VAL)
+            if(avg_tmp <= DTemp - heat_hyst)
             {
                 temp_cont_mode = HEATER_ON_STATE;   // Switch to heater mode
             }
+#endif
             heatLED_on();       // LED on
             break; 
         /*********************************************************************/
@@ -280,237 +561,700 @@ void Temp_Control_Task(void)
             cooler_off();                       // Cooler off
             heater_on();                        // Heater on
             cnt+=1;                             // increase cnt with one to control Heat element LED blinking time
+#if TEMP_DEADBAND
+            /* Stop heating at the set temperature */
+            if( avg_tmp >= DTemp)
+            {
+                temp_cont_mode = IDLE_STATE;        // Switch to idle mode
+            }
+#else
             /* Check if the temperature exceeded the error allowed if so switch to cooling */
-            if( avg_tmp >= DTemp + TEMP_ERROR_VAL)
+            if( avg_tmp >= DTemp + cool_hyst)
             {
                 temp_cont_mode = COOLER_ON_STATE;   // Switch to cooler mode
             }
-            if(cnt > HEAT_LED_BLINK_TIME / TEMP_CONTROL_TASK_PERIOD)
+#endif
+            if(cnt > blink_runs)
             {
                 cnt = 0;
                 heatLED_toggle();
             }
             break;       
         /*********************************************************************/
+            
+            
+        /* Idle mode (inside the band) ***************************************/
+        case IDLE_STATE:
+            heater_off();                       // Heater off
+            cooler_off();                       // Cooler off
+            heatLED_off();                      // LED off
+            if(avg_tmp <= DTemp - heat_hyst)
+            {
+                temp_cont_mode = HEATER_ON_STATE;   // Below the band, switch to heater mode
+            }
+            else if(avg_tmp >= DTemp + cool_hyst)
+            {
+                temp_cont_mode = COOLER_ON_STATE;   // Above the band, switch to cooler mode
+            }
+            break;
+        /*********************************************************************/
+    }
+}
+
+/*------------------------------------------------------------------*
+ * cal_start()
+ * This function starts the calibration at its first point, the reference
+ * temperature starts at the current reading. The edges collected before
+ * are dropped and the release of the plus press that started it is skipped.
+-*------------------------------------------------------------------*/
+static void cal_start(void)
+{
+    sw_get_press(PLUS_SW_MSK | MINUS_SW_MSK);
+    sw_get_release(PLUS_SW_MSK | MINUS_SW_MSK);
+    cal_skip = PLUS_SW_MSK;
+    cal_point = 0;
+    cal_ref[0] = (get_temp() > CAL_REF_MAX) ? CAL_REF_MAX : (unsigned char)get_temp();
+    cal_filt = temp_get_raw() << TEMP_CAL_RAW_SHIFT;
+    cal_code = 0xC1;
+    cal_name = DIAG_NAME_TICKS;
+    set_op_mode(CAL_MODE);
+}
+
+/*------------------------------------------------------------------*
+ * cal_capture()
+ * This function takes the filtered reading for the current point. After
+ * the second point the coefficients are computed (the only divides of the
+ * conversion), applied and saved, rejected points restart at the first one.
+-*------------------------------------------------------------------*/
+static void cal_capture(void)
+{
+    unsigned int gain;
+    int offset;
+
+    cal_raw[cal_point] = cal_filt;
+    if(cal_point == 0)
+    {
+        cal_point = 1;
+        cal_ref[1] = cal_ref[0];
+        cal_code = 0xC2;
+        cal_name = DIAG_NAME_TICKS;
+        return;
+    }
+    cal_point = 0;
+    if(temp_cal_compute(cal_raw[0], cal_ref[0], cal_raw[1], cal_ref[1], &gain, &offset) != TEMP_CAL_OK)
+    {
+        cal_code = 0xCE;
+        cal_name = DIAG_NAME_TICKS;
+        return;
+    }
+    temp_set_cal(gain, offset);
+    settings_set( SET_KEY_CAL_GAIN , gain );
+    settings_set( SET_KEY_CAL_OFFSET , (unsigned int)offset );
+    settings_commit();
+    logger_event(LOG_EV_CALIBRATION);
+    set_op_mode(TEMP_DISP_MODE);
+}
+
+/*------------------------------------------------------------------*
+ * cal_buttons(unsigned char lng)
+ * This function handles the buttons in the calibration mode. The sensor is
+ * put in a bath of known temperature, plus / minus set that temperature and
+ * plus held takes the point, the same again at a second temperature at
+ * least TEMP_CAL_MIN_SPAN away. The steps are taken at release as the
+ * press may start a long press, whose release is skipped.
+-*------------------------------------------------------------------*/
+static void cal_buttons(unsigned char lng)
+{
+    unsigned char rel , step;
+
+    sw_get_press(PLUS_SW_MSK | MINUS_SW_MSK);
+    rel = sw_get_release(PLUS_SW_MSK | MINUS_SW_MSK);
+    cal_skip |= lng;
+    if(lng & PLUS_SW_MSK)
+    {
+        cal_capture();
+    }
+    step = rel & ~cal_skip;             // short presses
+    cal_skip &= ~rel;                   // a long press ends at its release
+    if((step & PLUS_SW_MSK) && cal_ref[cal_point] < CAL_REF_MAX)
+    {
+        cal_ref[cal_point]++;
+    }
+    if((step & MINUS_SW_MSK) && cal_ref[cal_point] > 0)
+    {
+        cal_ref[cal_point]--;
     }
 }
 
 /*------------------------------------------------------------------*
- * SetTemp_Task()
- * This is the task responsible for setting the temperature with a step 
- * of 5 degrees celsius within the range 35 - 75
- * first plus or minus switch press enters the setting temperature mode.
- * Temperature is saved to external EEPROM to be retrieved when the power is disconnected
+ * Buttons_Event()
+ * This is the event handler responsible for the switches, the switches are
+ * sampled and debounced by the tick ISR which posts EV_SW_EDGE on a new
+ * edge, so this handler runs only when a switch changes.
+ * first plus or minus switch press enters the setting temperature mode, every
+ * next press sets the temperature with a step of 5 degrees celsius within the
+ * range 35 - 75.
+ * Plus and minus held together for SW_LONG_PRESS_TIME enter (or leave) the
+ * diagnostics mode, where plus / minus select the next / previous page.
+ * The second press of the combination is not taken as a setting step.
+ * Plus held in the diagnostics mode starts the sensor calibration (see
+ * cal_buttons()), plus and minus held together drop it.
+ * Temperature is saved to the settings store to be retrieved when the power is disconnected,
+ * the save is deferred until the setting mode times out (or power off / power fail).
  * If there was no interaction with the switch for (n)ms setting mode is turned
- * off and the display returns to displaying the temperature.
- * 
- * SetTemp_Task Explained:
- *      - state machine with three states
- *          * SW_DEPRESSED_STATE           when the switch is depressed
- *          * SW_PRESSED_STATE             when the switch is pressed at normal mode
- *          * SW_SET_MODE_PRESSED_STATE    when the switch is pressed at setting temperature mode
- *      - each state is responsible for the state transition
+ * off by SSD_UpdateDisp_Task() and the display returns to displaying the temperature.
+ * MCU shuts Down when the power switch is pressed then released.
 -*------------------------------------------------------------------*/ 
-void SetTemp_Task(void)
+void Buttons_Event(void)
 {
-    static SWITCH_STATES_ET sw_state = SW_DEPRESSED_STATE ;
-    static unsigned char count = 0 , BTN = NO_SW_NUM;
-    unsigned char mode = get_op_mode();
+    unsigned char press , lng;
     
+    /* Power switch released: power off ************************************/
+    if(sw_get_release(PWR_SW_MSK))
+    {
+        pwr_off();
+        return;
+    }
     
-    /* Checking the temperature mode *****************************************/
-    if(get_pwr_mode() == POWER_OFF)
+    /* Plus and minus held together: enter / leave the diagnostics mode **/
+    lng = sw_get_long(PLUS_SW_MSK | MINUS_SW_MSK);
+    if(lng == (PLUS_SW_MSK | MINUS_SW_MSK))
     {
-        set_op_mode(TEMP_DISP_MODE);
-        sw_state = SW_DEPRESSED_STATE;
-        set_pwr_mode(POWER_ON);
+        disp_idle = 0;
+        if(get_op_mode() == DIAG_MODE || get_op_mode() == CAL_MODE)
+        {
+            set_op_mode(TEMP_DISP_MODE);
+        }
+        else
+        {
+            if(get_op_mode() == TEMP_SET_MODE)
+            {
+                settings_commit();      // Leaving the setting mode saves as its timeout does
+            }
+            diag_page = DIAG_PG_LOAD;
+            set_op_mode(DIAG_MODE);
+        }
+        return;
     }
     
+    /* Calibration: the buttons are taken at release *************************/
+    if(get_op_mode() == CAL_MODE)
+    {
+        disp_idle = 0;
+        cal_buttons(lng);
+        return;
+    }
+    if(lng == PLUS_SW_MSK && get_op_mode() == DIAG_MODE)
+    {
+        disp_idle = 0;
+        cal_start();
+        return;
+    }
     
-    /* Checking the temperature mode *****************************************/
+    press = sw_get_press(PLUS_SW_MSK | MINUS_SW_MSK);
+    if(press == 0)
+    {
+        return;
+    }
+    disp_idle = 0;                      // restart the setting mode timeout
+    if(sw_is_down(PLUS_SW_MSK | MINUS_SW_MSK) == (PLUS_SW_MSK | MINUS_SW_MSK))
+    {
+        return;                         // combination, wait for the long press
+    }
     
-    if(mode == TEMP_SET_MODE)
+    /* Diagnostics mode: select the page *************************************/
+    if(get_op_mode() == DIAG_MODE)
     {
-        count += 1;     // Increase timeout count
-        /* Checking the last switch press time */
-        if(count > TEMP_SET_TIMEOUT/TEMP_SET_TASK_PERIOD)
+        if(press & PLUS_SW_MSK)
         {
-            // Time is out exit temperature display mode and go back to setting temperature mode
-            set_op_mode(TEMP_DISP_MODE);
-            count = 0;                      // Counter is reset for the next press
+            diag_page = (diag_page + 1 < DIAG_PG_NUM) ? diag_page + 1 : 0;
+        }
+        else
+        {
+            diag_page = (diag_page > 0) ? diag_page - 1 : DIAG_PG_NUM - 1;
         }
+        return;
     }
-    /*************************************************************************/
     
-    switch(sw_state)
+    /* Checking the temperature mode *****************************************/
+    if(get_op_mode() == TEMP_SET_MODE)
     {
-        /* switch is depressed at any mode ***********************************/
-        
-        case SW_DEPRESSED_STATE:
-            /* Checking if either of the plus or minus switches are pressed */
-            if(sw_is_pressed(PLUS_SW) == PRESSED || sw_is_pressed(MINUS_SW) == PRESSED)
-            {
-                /* Checking the operating mode */
-                if(mode == TEMP_SET_MODE)
-                {
-                    /* Operating at setting temperature mode the next state is SW_SET_MODE_PRESSED_STATE */
-                    sw_state = SW_SET_MODE_PRESSED_STATE; 
-                    /* Check which button of the two is pressed */
-                    if(sw_is_pressed(MINUS_SW) == PRESSED)
-                    {
-                        /* 
-                         * Checking the allowed temperature boundaries and saving 
-                         * the temperature to the EEPROM .
-                         */
-                        if(DTemp > MIN_SET_TEMP)  
-                        {   DTemp -= TEMP_SET_STEP;
-                            e2pext_w( TEMP_SAVE_ADDRESS , DTemp );
-                        }
-                    }
-                    else
-                    {
-                        /* 
-                         * Checking the allowed temperature boundaries and saving 
-                         * the temperature to the EEPROM .
-                         */
-                        if(DTemp < MAX_SET_TEMP)  
-                        {
-                            DTemp += TEMP_SET_STEP;
-                            e2pext_w( TEMP_SAVE_ADDRESS , DTemp );
-                        }
-                    }
-                }
-                else
-                {
-                    /* Operating at normal mode -first plus or minus press- the next state is SW_PRESSED_STATE */
-                    sw_state = SW_PRESSED_STATE;
-                }
-                /* Checking which switch was pressed */
-                if(sw_is_pressed(MINUS_SW) == PRESSED)
-                {
-                    BTN = MINUS_SW_NUM;
-                }
-                else
-                {
-                    BTN = PLUS_SW_NUM;
-                }
-                
-            }
-            break;
-        /*********************************************************************/
-            
-            
-        /* switch is pressed at normal mode **********************************/
-        case SW_PRESSED_STATE:
-            /* Checking if the switch pressed is the one released */
-            if((sw_is_pressed(MINUS_SW) == DEPRESSED && BTN == MINUS_SW_NUM )|| ( sw_is_pressed(PLUS_SW) == DEPRESSED && BTN == PLUS_SW_NUM ))
-            {
-                /* 
-                 * as the switch is released and the operating mode is normal mode
-                 * hence this is the first switch application must enter setting temperature mode
-                 */
-                set_op_mode(TEMP_SET_MODE);
-                sw_state = SW_DEPRESSED_STATE;
-            }
-            count = 0;                      // counter remains 0 while pressing one of the switches
-            break;
-        /*********************************************************************/
-            
-            
-        /* switch is pressed at setting temperature mode *********************/
-        case SW_SET_MODE_PRESSED_STATE:
-            /* Check which switch is released at temperature setting mode */
-            if(sw_is_pressed(MINUS_SW) == DEPRESSED && BTN == MINUS_SW_NUM)
-            {
-                sw_state = SW_DEPRESSED_STATE;
-            }         
-            if(sw_is_pressed(PLUS_SW) == DEPRESSED && BTN == PLUS_SW_NUM)
-            {
-                sw_state = SW_DEPRESSED_STATE;
-            }
-            count = 0;                          // counter remains 0 while pressing one of the switches
-            break;
-        /*********************************************************************/
+        /* 
+         * Checking the allowed temperature boundaries, the
+         * temperature is saved when the setting mode times out.
+         */
+        if((press & MINUS_SW_MSK) && DTemp > MIN_SET_TEMP)
+        {
+            DTemp -= TEMP_SET_STEP;
+            settings_set( SET_KEY_DTEMP , DTemp );
+            logger_event(LOG_EV_SETPOINT);
+            rate_fast();
+        }
+        if((press & PLUS_SW_MSK) && DTemp < MAX_SET_TEMP)
+        {
+            DTemp += TEMP_SET_STEP;
+            settings_set( SET_KEY_DTEMP , DTemp );
+            logger_event(LOG_EV_SETPOINT);
+            rate_fast();
+        }
+    }
+    else
+    {
+        /* first plus or minus press enters setting temperature mode */
+        set_op_mode(TEMP_SET_MODE);
     }
 }
 
 /*------------------------------------------------------------------*
- * pwr_off()
- * This is a one time-call function called to put MCU to sleep.
+ * log_record()
+ * This function adds a record of the current state to the temperature logger.
+-*------------------------------------------------------------------*/
+static void log_record(void)
+{
+    unsigned char state = LOG_STATE_IDLE;
+
+    if(heater_is_on())
+    {
+        state = LOG_STATE_HEATER;
+    }
+    else if(cooler_is_on())
+    {
+        state = LOG_STATE_COOLER;
+    }
+    logger_add((unsigned char)avg_tmp, DTemp, state);
+}
+
+/*------------------------------------------------------------------*
+ * Log_Task()
+ * This is the task responsible for the temperature history.
+ * A periodic function that is repeated every second, a record is added
+ * every (n)s where n can be changed from configuration file. The records
+ * are collected in RAM and written a page at a time by the logger. The
+ * energy meter counts the same seconds.
+-*------------------------------------------------------------------*/
+void Log_Task(void)
+{
+    static unsigned int sec = 0;
+
+    energy_update();
+    sec += 1;
+    if(sec >= LOG_INTERVAL)
+    {
+        sec = 0;
+        log_record();
+    }
+}
+
+/*------------------------------------------------------------------*
+ * outputs_suspend()
+ * Power hook: the heater, cooler and heat LED are turned off.
  * ** note: at sleep mode all MCU ports and pins remain the same before sleeping
  * ** so it should be turned off before going to sleep mode.
 -*------------------------------------------------------------------*/
-void pwr_off(void)
+static void outputs_suspend(void)
 {
-    ssd_off();          // Power off SSDs
-    heatLED_off();      // Power off heat element LED
     heater_off();       // Power off heater element
     cooler_off();       // Power off cooler element
-    sch_stop();         // Stop scheduler
+    heatLED_off();      // Power off heat element LED
+}
+
+/*------------------------------------------------------------------*
+ * display_resume()
+ * Power hook: the display is awake after power on, the frame buffer is
+ * rendered at once (not at the next SSD_UpdateDisp_Task() slot) and the
+ * multiplexing starts again (ssd_off() is the suspend hook).
+-*------------------------------------------------------------------*/
+static void display_resume(void)
+{
+    disp_idle = 0;
+    SSD_UpdateDisp_Task();      // Render the fresh reading before the first digit slot
+    resume_mark(RESUME_PH_DISPLAY);
+    ssd_mux_start();
+}
+
+/*------------------------------------------------------------------*
+ * control_resume()
+ * Power hook: readings taken before the sleep are not used. The averaging
+ * buffer is seeded with the mean of a burst of TEMP_RESUME_SAMPLES
+ * readings so the control takes its first decision now instead of after
+ * TEMP_READINGS_AVG control periods (about 1s). With TEMP_RESUME_SAMPLES 0
+ * the buffer is refilled by the control task as before.
+-*------------------------------------------------------------------*/
+static void control_resume(void)
+{
+#if TEMP_RESUME_SAMPLES > 0
+    unsigned char i;
+    unsigned short sum = 0;
+    
+    rate_fast();                            // The tank may have changed during the sleep
+    for(i = 0 ; i < TEMP_RESUME_SAMPLES ; i++)
+    {
+        temp_update();
+        sum += get_temp();
+    }
+    sum /= TEMP_RESUME_SAMPLES;
+    for(i = 0 ; i < TEMP_READINGS_AVG ; i++)
+    {
+        tmp[i] = sum;
+    }
+    tmp_ind = 0;
+    temp_cont_mode = TEMP_CONTROL_OFF;      // The buffer is full, decide at once
+    resume_mark(RESUME_PH_FILTER);
+    Temp_Control_Task();                    // First control decision
+    resume_mark(RESUME_PH_CONTROL);
+#else
+    rate_fast();                            // The tank may have changed during the sleep
+    tmp_ind = 0;
+    temp_cont_mode = NO_ENOUGH_READINGS;
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * ui_resume()
+ * Power hook: start at temperature display mode and drop the switch
+ * edges collected before the sleep.
+-*------------------------------------------------------------------*/
+static void ui_resume(void)
+{
+    set_op_mode(TEMP_DISP_MODE);
+    sw_clear_edges();
+}
+
+/*------------------------------------------------------------------*
+ * logger_suspend() / logger_resume()
+ * Power hooks: the power events are logged and the partially filled
+ * logger page is written at power off. Nothing is logged when the MCU
+ * was not running (start up) or after a power fail (pwr_fail() wrote
+ * the page already).
+-*------------------------------------------------------------------*/
+static void logger_suspend(void)
+{
+    if(pwr_mode == POWER_ON)
+    {
+        logger_event(LOG_EV_POWER_OFF);
+        log_record();   // Save the state at power off
+        logger_flush(); // Write the partially filled logger page
+    }
+}
+
+static void logger_resume(void)
+{
+    logger_event(LOG_EV_POWER_ON);
+}
+
+/*------------------------------------------------------------------*
+ * settings_suspend()
+ * Power hook: save a set temperature changed just before power off.
+-*------------------------------------------------------------------*/
+static void settings_suspend(void)
+{
+    settings_commit();
+}
+
+/*------------------------------------------------------------------*
+ * pwr_off()
+ * This is a one time-call function called to put MCU to sleep. The modules
+ * are stopped by their suspend hooks (see pwr_hooks_creation()).
+ * DEBUG_PWR_MSK is high from the call to the sleep (sleep entry time).
+-*------------------------------------------------------------------*/
+void pwr_off(void)
+{
+    DEBUG_PORT |= DEBUG_PWR_MSK;
+    TRACE(TRACE_PWR, POWER_OFF);
+    pwrmgr_suspend();   // Run the suspend hooks
     set_pwr_mode(POWER_OFF);
     /* 
      * Enable external interrupt as it is disabled while the application
-     * is running as the open power on function is called in the external
+     * is running as the power on event is posted by the external
      * interrupt function implementation.
      */
     ext_int_en();       
-    asm("SLEEP");       // Put MCU to sleep mode
+    DEBUG_PORT &= ~DEBUG_PWR_MSK;
+    /*
+     * Put MCU to sleep mode. The watchdog wakes it up every ~18ms without
+     * running the ISR, it sleeps again until the external interrupt (its
+     * ISR disables INTE) woke it.
+     */
+    do
+    {
+        asm("SLEEP");
+        asm("NOP");     // Executed before the ISR after a wake up
+    }
+    while(INTE);
 }
 
 /*------------------------------------------------------------------*
  * pwr_on()
  * This is a one time-call function called to initialize MCU after being in sleep mode.
+ * It is the handler of EV_PWR_ON posted by the external interrupt, the
+ * modules are restarted by their resume hooks in the reverse order.
+ * DEBUG_PWR_MSK is high while the resume hooks run and every phase is time
+ * stamped by resume_mark(), the first display frame follows the next
+ * Timer 2 interrupt.
 -*------------------------------------------------------------------*/
 void pwr_on(void)
 {
-    set_op_mode(TEMP_DISP_MODE);  // Initialize display mode to start at temperature display mode
+    DEBUG_PORT |= DEBUG_PWR_MSK;
+    resume_mark(RESUME_PH_HOOKS);
     ext_int_dis();              // Disable external interrupt to not interfere with power off function
-    sch_start();                // Start schedulers as it was stopped at the power off sequence
+    pwrmgr_resume();            // Run the resume hooks (the scheduler starts last)
+    set_pwr_mode(POWER_ON);
+    TRACE(TRACE_PWR, POWER_ON);
+    resume_mark(RESUME_PH_SCH);
+    DEBUG_PORT &= ~DEBUG_PWR_MSK;
 }
 
 /*------------------------------------------------------------------*
- * BTN_PwrOFF_Task()
- * This is the task responsible for checking the power switch state and calling 
- * the power off sequence.
- * A periodic function that is repeated every (n)ms, n can be changed from
- * configuration file.
- * MCU shuts Down when the switch is pressed then released
- * 
- * BTN_PwrOFF_Task Explained:
- *      - state machine with two states
- *          * SW_DEPRESSED_STATE           when the switch is depressed
- *          * SW_PRESSED_STATE             when the switch is pressed
- *      - each state is responsible for the state transition
--*------------------------------------------------------------------*/ 
-void BTN_PwrOFF_Task(void)
-{    
-    static unsigned char state = 0;
+ * resume_mark(RESUME_PHASE_T phase)
+ * This function time stamps a resume phase, RESUME_PH_WAKE is marked by the
+ * external interrupt and the other phases are kept relative to it.
+-*------------------------------------------------------------------*/
+void resume_mark(RESUME_PHASE_T phase)
+{
+    uint16_t now = tstamp_get();
     
-    switch(state)
+    if(phase == RESUME_PH_WAKE)
     {
-        // Button is depressed
-        case SW_DEPRESSED_STATE:
-            /*
-             * Checking if the button is pressed if so go to SW_Pressed_STATE
-             */
-            if(sw_is_pressed(PWR_SW) == PRESSED)
-            {
-                state = SW_PRESSED_STATE;
-            }
-            break;
-        // Button is Pressed
-        case SW_PRESSED_STATE:
-            /* Wait until the switch is released then switch to SW_DEPRESSED_STATE and power off */
-            if(sw_is_pressed(PWR_SW) == DEPRESSED)
-            {
-                state = SW_DEPRESSED_STATE;
-                pwr_off();
-            }
-            break;
-    }     
+        resume_base = now;
+    }
+    resume_ts[phase] = now - resume_base;
+}
+
+/*------------------------------------------------------------------*
+ * get_resume_time(RESUME_PHASE_T phase)
+ * This function gets the time of a phase of the last resume after the
+ * wake up interrupt in TSTAMP_US_PER_TICK units.
+-*------------------------------------------------------------------*/
+unsigned int get_resume_time(RESUME_PHASE_T phase)
+{
+    return resume_ts[phase];
+}
+
+/*------------------------------------------------------------------*
+ * pwr_fail()
+ * This is the brown-out handler called when the supply monitor detects a
+ * mains drop. It runs inside the hold-up time of the supply capacitor so
+ * only the minimum is done, in this order:
+ *      - the heater / cooler relays and the displays are turned off first
+ *        as they drain the hold-up capacitor the most.
+ *      - the scheduler is stopped so no task starts another EEPROM access.
+ *      - the dirty settings (set temperature, energy counter) are written
+ *        with one page write and the write cycle is waited for.
+ *      - a record with LOG_EV_POWER_FAIL is added and the logger page is
+ *        written once. It comes second so a supply gone before its write
+ *        cycle ends only tears the logger page, which its CRC rejects.
+ * Then the MCU sleeps as after a normal power off, the suspend hooks find
+ * the settings clean and skip the logger (pwr_mode is POWER_OFF).
+ * Worst case from the supply drop: SUPPLY_LOW_SAMPLES * SUPPLY_TASK_PERIOD
+ * detection + one task duration + 2 x (~2.5ms page transfer + 5ms tWR).
+ * STORAGE_BACKEND_INT has no page buffer, every byte blocks for its ~4ms
+ * write cycle: ~64ms per STORAGE_PAGE_SIZE page, ~128ms for both pages,
+ * longer than the hold-up time. Only the settings page is written there,
+ * the records since the last logger flush are lost.
+ * DEBUG_PWR_FAIL_MSK is high while the handler runs to measure it on a scope.
+-*------------------------------------------------------------------*/
+void pwr_fail(void)
+{
+    DEBUG_PORT |= DEBUG_PWR_FAIL_MSK;
+    outputs_suspend();  // Shed the largest loads first
+    ssd_off();
+    sch_stop();         // No other task may start while saving
+    settings_commit();  // Single page write of the dirty settings
+    storage_wait_ready();
+#if STORAGE_BACKEND != STORAGE_BACKEND_INT
+    logger_event(LOG_EV_POWER_FAIL);
+    log_record();
+    logger_flush();     // Single page write of the logger
+    storage_wait_ready();
+#endif
+    DEBUG_PORT &= ~DEBUG_PWR_FAIL_MSK;
+    pwr_mode = POWER_OFF;   // Skip the logger flush of pwr_off()
+    pwr_off();              // The remaining suspend hooks find nothing left to do
 }
 
+/*------------------------------------------------------------------*
+ * Supply_Monitor_Task()
+ * This is the task responsible for the power fail early warning.
+ * A periodic function that is repeated every (n)ms, n can be changed from
+ * configuration file. It is the first task in the scheduler buffer so it is
+ * dispatched first after every tick.
+-*------------------------------------------------------------------*/
+void Supply_Monitor_Task(void)
+{
+    if(supply_is_low())
+    {
+        pwr_fail();
+    }
+}
 
+/*------------------------------------------------------------------*
+ * status_flags()
+ * This function gets the outputs, the display mode and the sensor fault as
+ * TELEM_FLAG_xxx bits, shared by the telemetry frame and the Modbus registers.
+-*------------------------------------------------------------------*/
+static unsigned char status_flags(void)
+{
+    return (heater_is_on() ? TELEM_FLAG_HEATER : 0)
+         | (cooler_is_on() ? TELEM_FLAG_COOLER : 0)
+         | ((OP_mode == TEMP_SET_MODE) ? TELEM_FLAG_SET_MODE : 0)
+         | ((temp_get_fault() != TEMP_FAULT_NONE) ? TELEM_FLAG_SENSOR_FAULT : 0);
+}
+
+/*------------------------------------------------------------------*
+ * Telemetry_Task()
+ * This is the task responsible for the serial telemetry.
+ * The payload is a fixed copy of the state already computed by the other
+ * tasks, nothing is formatted here and the bytes are sent by the TXIF
+ * interrupt, so a frame costs the same few hundred cycles every period.
+-*------------------------------------------------------------------*/
+void Telemetry_Task(void)
+{
+    static unsigned char seq = 0;
+    unsigned char st[TELEM_ST_SIZE];
+    unsigned char cmd;
+    unsigned short t = get_temp();
+    unsigned int peak = SCH_Get_Peak_Busy();
+
+    while(usart_getc(&cmd))
+    {
+#if TRACE_ENABLE
+        if(cmd == TELEM_CMD_TRACE)
+        {
+            trace_dump(usart_putc);     // Waits while the TX ring is full
+        }
+#endif
+    }
+    st[TELEM_ST_TEMP] = (unsigned char)t;
+    st[TELEM_ST_TEMP + 1] = (unsigned char)(t >> 8);
+    st[TELEM_ST_AVG] = (unsigned char)avg_tmp;
+    st[TELEM_ST_AVG + 1] = (unsigned char)(avg_tmp >> 8);
+    st[TELEM_ST_DTEMP] = DTemp;
+    st[TELEM_ST_FLAGS] = status_flags();
+    st[TELEM_ST_ERROR] = SCH_Get_Error();
+    st[TELEM_ST_OVERRUNS] = overruns_sum();
+    st[TELEM_ST_WDT_RESETS] = SCH_Get_WDT_Resets();
+    st[TELEM_ST_STALLED] = SCH_Get_Stalled();
+    st[TELEM_ST_SEQ] = seq++;       // Gaps on the host show dropped frames
+    st[TELEM_ST_LOAD] = SCH_Get_Load();
+    st[TELEM_ST_ISR_LOAD] = SCH_Get_ISR_Load();
+    st[TELEM_ST_PEAK] = (unsigned char)peak;
+    st[TELEM_ST_PEAK + 1] = (unsigned char)(peak >> 8);
+    telem_send(TELEM_TYPE_STATUS, st, TELEM_ST_SIZE);
+#if BENCH_ENABLE
+    {
+        static unsigned char bench_id = 0;
+        unsigned int cycles = bench_get(bench_id);
+
+        st[TELEM_BN_ID] = bench_id;
+        st[TELEM_BN_CYCLES] = (unsigned char)cycles;
+        st[TELEM_BN_CYCLES + 1] = (unsigned char)(cycles >> 8);
+        telem_send(TELEM_TYPE_BENCH, st, TELEM_BN_SIZE);
+        bench_id = (bench_id + 1) % BENCH_NUM;    // One routine per period
+    }
+#endif
+}
+
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+/*------------------------------------------------------------------*
+ * mb_read_reg()
+ * This is the Modbus read callback, it only copies values the tasks
+ * already keep so a read never waits.
+-*------------------------------------------------------------------*/
+static unsigned char mb_read_reg(unsigned char table, unsigned int reg, unsigned int *val)
+{
+    if(table == MB_TABLE_HOLDING)
+    {
+        switch(reg)
+        {
+            case MB_HR_DTEMP:       *val = get_Desired_temperature();   break;
+            case MB_HR_HEAT_HYST:   *val = heat_hyst;                   break;
+            case MB_HR_COOL_HYST:   *val = cool_hyst;                   break;
+            default:                return MB_EX_ILLEGAL_ADDRESS;
+        }
+        return MB_OK;
+    }
+    switch(reg)
+    {
+        case MB_IR_TEMP:        *val = get_temp();                  break;
+        case MB_IR_AVG_TEMP:    *val = avg_tmp;                     break;
+        case MB_IR_PWR_MODE:    *val = pwr_mode;                    break;
+        case MB_IR_OUTPUTS:     *val = status_flags();              break;
+        case MB_IR_SCH_ERROR:   *val = SCH_Get_Error();             break;
+        case MB_IR_OVERRUNS:    *val = overruns_sum();              break;
+        case MB_IR_WDT_RESETS:  *val = SCH_Get_WDT_Resets();        break;
+        case MB_IR_STALLED:     *val = SCH_Get_Stalled();           break;
+        case MB_IR_BAD_FRAMES:  *val = modbus_get_bad_frames();     break;
+        case MB_IR_CPU_LOAD:    *val = SCH_Get_Load();              break;
+        case MB_IR_ISR_LOAD:    *val = SCH_Get_ISR_Load();          break;
+        case MB_IR_PEAK_BUSY:   *val = SCH_Get_Peak_Busy();         break;
+        case MB_IR_ENERGY_DAY:  *val = energy_get_day();            break;
+        case MB_IR_ENERGY_LAST: *val = energy_get_last_day();       break;
+        case MB_IR_ENERGY_LO:   *val = (unsigned int)energy_get_total();            break;
+        case MB_IR_ENERGY_HI:   *val = (unsigned int)(energy_get_total() >> 16);    break;
+        default:                return MB_EX_ILLEGAL_ADDRESS;
+    }
+    return MB_OK;
+}
+
+/*------------------------------------------------------------------*
+ * mb_write_reg()
+ * This is the Modbus write callback. A new set temperature is handled
+ * like a button change: saved when the settings are next committed, the
+ * hysteresis values are saved the same way.
+-*------------------------------------------------------------------*/
+static unsigned char mb_write_reg(unsigned int reg, unsigned int val)
+{
+    if(reg == MB_HR_HEAT_HYST || reg == MB_HR_COOL_HYST)
+    {
+        if(val > TEMP_HYST_MAX || val < TEMP_HYST_MIN)
+        {
+            return MB_EX_ILLEGAL_VALUE;
+        }
+        if(reg == MB_HR_HEAT_HYST)
+        {
+            heat_hyst = (unsigned char)val;
+            settings_set( SET_KEY_HEAT_HYST , val );
+        }
+        else
+        {
+            cool_hyst = (unsigned char)val;
+            settings_set( SET_KEY_COOL_HYST , val );
+        }
+        return MB_OK;
+    }
+    if(reg != MB_HR_DTEMP)
+    {
+        return MB_EX_ILLEGAL_ADDRESS;
+    }
+    if(val > MAX_SET_TEMP || val < MIN_SET_TEMP)
+    {
+        return MB_EX_ILLEGAL_VALUE;
+    }
+    if(val != get_Desired_temperature())
+    {
+        set_Desired_temperature((unsigned char)val);
+        settings_set( SET_KEY_DTEMP , val );
+        rate_fast();
+        logger_event(LOG_EV_SETPOINT);
+    }
+    return MB_OK;
+}
+#endif
+
+/*------------------------------------------------------------------*
+ * hyst_load()
+ * This function gets a saved hysteresis, TEMP_ERROR_VAL if it is out of range.
+-*------------------------------------------------------------------*/
+static unsigned char hyst_load(SETTINGS_KEY_T key)
+{
+    unsigned int val = settings_get(key);
+
+    if(val > TEMP_HYST_MAX || val < TEMP_HYST_MIN)
+    {
+        return TEMP_ERROR_VAL;
+    }
+    return (unsigned char)val;
+}
 
 /*------------------------------------------------------------------*
  * MC_init()
@@ -519,38 +1263,92 @@ void BTN_PwrOFF_Task(void)
 -*------------------------------------------------------------------*/ 
 void MC_init(void)
 {
-    e2pext_init();                          // Initialize external EEPROM
-    sw_init(PLUS_SW);                       // Initialize plus switch
-    sw_init(MINUS_SW);                      // Initialize minus switch
-    sw_init(PWR_SW);                        // Initialize power on/off switch
+    sch_init();                             // Initialize scheduler (reads the reset cause first)
+    storage_init();                         // Initialize the settings / logger storage
+    sw_init(PLUS_SW_MSK);                   // Initialize plus switch
+    sw_init(MINUS_SW_MSK);                  // Initialize minus switch
+    sw_init(PWR_SW_MSK);                    // Initialize power on/off switch
     cooler_init();                          // Initialize cooling element
     heater_init();                          // Initialize heating element
-    ssd_init(SSD2_MSK);                     // Initialize 2nd seven segment display
-    ssd_init(SSD3_MSK);                     // Initialize 3rd seven segment display
+    ssd_init(SSD_USED_MSK);                 // Initialize the seven segment displays
+    ssd_mux_init();                         // Initialize seven segment multiplexing timer
     heatLED_init();                         // Initialize heating element LED
     temp_sensor_init(TEMP_SENSOR_CH);       // Initialize temperature sensor
-    sch_init();                             // Initialize scheduler
+    supply_init(SUPPLY_SENSE_CH);           // Initialize supply monitor
+    tstamp_init();                          // Initialize the Timer 1 time base
+    usart_init();                           // Initialize the serial port
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+    modbus_init(MODBUS_ADDRESS, mb_read_reg, mb_write_reg);
+#endif
+    DEBUG_IO_REG &= ~DEBUG_ALL_MSK;         // Initialize debug pins as outputs
     init_ext_int();                         // Initialize external interrupt   
-    DTemp = e2pext_r( TEMP_SAVE_ADDRESS );  // Retrieve saved temperature
+    settings_init();                        // Load the newest valid saved settings
+    DTemp = settings_get(SET_KEY_DTEMP);    // Retrieve saved temperature
+    if(DTemp > MAX_SET_TEMP || DTemp < MIN_SET_TEMP)
+    {
+        DTemp = INITIAL_TEMP;
+    }
+    temp_set_cal(settings_get(SET_KEY_CAL_GAIN), (int)settings_get(SET_KEY_CAL_OFFSET));
+    heat_hyst = hyst_load(SET_KEY_HEAT_HYST);
+    cool_hyst = hyst_load(SET_KEY_COOL_HYST);
+    energy_init();                          // Continue the lifetime energy counter
+    logger_init();                          // Continue the temperature history after the newest page
+    if(SCH_Get_Stalled() != SCH_NO_STALL)
+    {
+        logger_event(LOG_EV_WDT_RESET);     // The stalled task is kept by the scheduler
+    }
 }
 
 /*------------------------------------------------------------------*
  * tasks_creation()
  * This is a one time call function at the start to add all the application tasks
- * to the scheduler buffer.
+ * to the scheduler buffer and to register the event handlers.
 -*------------------------------------------------------------------*/ 
 void tasks_creation(void)
 {
-    SCH_Add_Task( BTN_PwrOFF_Task , PWR_TASK_CREATION_DELAY , PWR_TASK_CREATION_PERIOD);
-    SCH_Add_Task( Temp_Sense_Task , TEMP_SENSE_TASK_CREATION_DELAY , TEMP_SENSE_TASK_CREATION_PERIOD);
-    SCH_Add_Task( Temp_Control_Task , TEMP_CONTROL_TASK_CREATION_DELAY , TEMP_CONTROL_TASK_CREATION_PERIOD);
-    SCH_Add_Task( SSD_UpdateDisp_Task , SSD_TASK_CREATION_DELAY , SSD_TASK_CREATION_PERIOD);
-    SCH_Add_Task( SetTemp_Task , TEMP_SET_TASK_CREATION_DELAY , TEMP_SET_TASK_CREATION_PERIOD);  
+    /* 
+     * Overrun policies: a late sample or display update is only useful once
+     * (skip), a late control decision is skipped and reported, the log task
+     * counts seconds so it catches up (default), a late telemetry frame is
+     * skipped.
+     */
+    SCH_Set_Policy( SCH_Add_Task( Supply_Monitor_Task , SUPPLY_TASK_CREATION_DELAY , SUPPLY_TASK_CREATION_PERIOD) , SCH_SKIP );
+    sense_task = SCH_Add_Task( Temp_Sense_Task , TEMP_SENSE_TASK_CREATION_DELAY , TEMP_SENSE_TASK_CREATION_PERIOD);
+    SCH_Set_Policy( sense_task , SCH_SKIP );
+    control_task = SCH_Add_Task( Temp_Control_Task , TEMP_CONTROL_TASK_CREATION_DELAY , TEMP_CONTROL_TASK_CREATION_PERIOD);
+    SCH_Set_Policy( control_task , SCH_COUNT );
+    SCH_Set_Policy( SCH_Add_Task( SSD_UpdateDisp_Task , SSD_TASK_CREATION_DELAY , SSD_TASK_CREATION_PERIOD) , SCH_SKIP );
+    SCH_Add_Task( Log_Task , LOG_TASK_CREATION_DELAY , LOG_TASK_CREATION_PERIOD);
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_TELEM
+    SCH_Set_Policy( SCH_Add_Task( Telemetry_Task , TELEM_TASK_CREATION_DELAY , TELEM_TASK_CREATION_PERIOD) , SCH_SKIP );
+#endif
+    SCH_Add_Event_Handler( EV_PWR_ON , pwr_on );
+    SCH_Add_Event_Handler( EV_SW_EDGE , Buttons_Event );
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+    SCH_Add_Event_Handler( EV_MB_FRAME , modbus_process );
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * pwr_hooks_creation()
+ * This is a one time call function at the start to register the suspend and
+ * resume hooks of the modules with the power manager. Suspend runs in the
+ * PWR_ORDER_T order, resume in the reverse order.
+-*------------------------------------------------------------------*/ 
+void pwr_hooks_creation(void)
+{
+    pwrmgr_register( sch_stop , sch_start , PWR_ORDER_SCH );
+    pwrmgr_register( outputs_suspend , 0 , PWR_ORDER_OUTPUTS );
+    pwrmgr_register( ssd_off , display_resume , PWR_ORDER_DISPLAY );
+    pwrmgr_register( 0 , control_resume , PWR_ORDER_CONTROL );
+    pwrmgr_register( 0 , ui_resume , PWR_ORDER_UI );
+    pwrmgr_register( logger_suspend , logger_resume , PWR_ORDER_LOGGER );
+    pwrmgr_register( settings_suspend , 0 , PWR_ORDER_SETTINGS );
 }
 
 /*------------------------------------------------------------------*
  * set_op_mode(DISP_MOD_T val)
- * This function saves the current operation mode either TEMP_DISP_MODE or TEMP_SET_MODE
+ * This function saves the current operation mode TEMP_DISP_MODE, TEMP_SET_MODE, DIAG_MODE or CAL_MODE
  * to a static global variable < OP_mode >
 -*------------------------------------------------------------------*/
 void set_op_mode(DISP_MOD_T val)
@@ -571,26 +1369,10 @@ void set_Desired_temperature(unsigned char val)
  * set_pwr_mode(PWR_MOD_T val)
  * This function saves the current power mode either POWER_OFF or POWER_ON
  * to a static global variable < pwr_mode >
- * note:    this function must be called more than one time to change the power
- *          mode from OFF to ON as more than one function needs resetting some 
- *          of it's values at start
 -*------------------------------------------------------------------*/
 void set_pwr_mode(PWR_MOD_T val)
 {
-    static unsigned char cnt = PWR_ON_TASKS_CNT;
-    if(val == POWER_ON)
-    {
-        cnt--;
-        if(cnt == 0)
-        {
-           pwr_mode = val;
-           cnt = PWR_ON_TASKS_CNT;
-        }
-    }
-    else
-    {
-        pwr_mode = val;
-    }
+    pwr_mode = val;
 }
 
 /*------------------------------------------------------------------*
@@ -620,6 +1402,15 @@ PWR_MOD_T get_pwr_mode(void)
     return pwr_mode;
 }
 
+/*------------------------------------------------------------------*
+ * unsigned short get_avg_temperature()
+ * This function gets the average of the last k temperature readings
+-*------------------------------------------------------------------*/
+unsigned short get_avg_temperature(void)
+{
+    return avg_tmp;
+}
+
 /*------------------------------------------------------------------*
  * inc_DTemp(unsigned char increase_val)
  * This function increases the set temperature by a given value
@@ -26,29 +26,55 @@
 *       Task Creation Period and Delay depends on the system tick and the actual
 *       task delay and period
 *******************************************************************************/
-#define PWR_TASK_CREATION_PERIOD                PWR_TASK_PERIOD/SCH_TICK
-#define PWR_TASK_CREATION_DELAY                 PWR_TASK_DELAY/SCH_TICK
 #define TEMP_SENSE_TASK_CREATION_PERIOD         TEMP_SENSE_TASK_PERIOD/SCH_TICK
 #define TEMP_SENSE_TASK_CREATION_DELAY          TEMP_SENSE_TASK_DELAY/SCH_TICK
 #define TEMP_CONTROL_TASK_CREATION_PERIOD       TEMP_CONTROL_TASK_PERIOD/SCH_TICK
 #define TEMP_CONTROL_TASK_CREATION_DELAY        TEMP_CONTROL_TASK_DELAY/SCH_TICK
 #define SSD_TASK_CREATION_PERIOD                SSD_TASK_PERIOD/SCH_TICK
 #define SSD_TASK_CREATION_DELAY                 SSD_TASK_DELAY/SCH_TICK
-#define TEMP_SET_TASK_CREATION_PERIOD           TEMP_SET_TASK_PERIOD/SCH_TICK
-#define TEMP_SET_TASK_CREATION_DELAY            TEMP_SET_TASK_DELAY/SCH_TICK
+#define LOG_TASK_CREATION_PERIOD                LOG_TASK_PERIOD/SCH_TICK
+#define LOG_TASK_CREATION_DELAY                 LOG_TASK_DELAY/SCH_TICK
+#define SUPPLY_TASK_CREATION_PERIOD             SUPPLY_TASK_PERIOD/SCH_TICK
+#define SUPPLY_TASK_CREATION_DELAY              SUPPLY_TASK_DELAY/SCH_TICK
+#define TELEM_TASK_CREATION_PERIOD              TELEM_TASK_PERIOD/SCH_TICK
+#define TELEM_TASK_CREATION_DELAY               TELEM_TASK_DELAY/SCH_TICK
+#define SSD_BLANK_TICKS                         ((SSD_BLANK_TIMEOUT * 60000UL) / SSD_TASK_PERIOD)
+#define TEMP_SET_TICKS                          (TEMP_SET_TIMEOUT / SSD_TASK_PERIOD)
+#define DIAG_TICKS                              (DIAG_TIMEOUT / SSD_TASK_PERIOD)
+#define DIAG_NAME_TICKS                         (DIAG_NAME_TIME / SSD_TASK_PERIOD)
+#define CAL_TICKS                               (TEMP_CAL_TIMEOUT / SSD_TASK_PERIOD)
+#define TEMP_ADAPT_SLOW_TICKS                   (TEMP_ADAPT_SLOW_PERIOD / SCH_TICK)
+#define CAL_REF_MAX                             99      // two digits
 
 /*****************************************************************************
  *
- *  Seven Segments Display states
+ *  Display modes
  *
  *****************************************************************************/
 typedef enum{
-    SSD1 = 1 ,SSD2 , SSD_Blinking
-}SSD_STATE_ET;
+    TEMP_DISP_MODE,TEMP_SET_MODE,DIAG_MODE,CAL_MODE
+}DISP_MOD_T;
+/*****************************************************************************/
 
+/*****************************************************************************
+ *
+ *  Diagnostics display pages (shown as d1, d2 .. d9, dA .. then the value, at most 15)
+ *
+ *****************************************************************************/
 typedef enum{
-    TEMP_DISP_MODE,TEMP_SET_MODE
-}DISP_MOD_T;
+    DIAG_PG_LOAD        ,   // CPU load, percent
+    DIAG_PG_ISR_LOAD    ,   // interrupts load, percent
+    DIAG_PG_PEAK        ,   // busy time of the worst tick, 0.1ms
+    DIAG_PG_SCH_ERROR   ,   // E and the SCH_E code of the last scheduler error
+    DIAG_PG_OVERRUNS    ,   // sum of the task overruns, hex
+    DIAG_PG_MAX_TASK    ,   // longest run of a task, 0.1ms
+    DIAG_PG_E2P_ERRORS  ,   // storage access errors, hex (FF = 255 or more)
+    DIAG_PG_ADC_TEMP    ,   // raw temperature sensor reading / 4, hex
+    DIAG_PG_ADC_SUPPLY  ,   // raw supply reading / 4, hex
+    DIAG_PG_ENERGY_DAY  ,   // energy of the current day, 0.1kWh then kWh
+    DIAG_PG_ENERGY_LIFE ,   // lifetime energy, 0.1MWh then MWh
+    DIAG_PG_NUM
+}DIAG_PAGE_T;
 /*****************************************************************************/
 /*****************************************************************************
  *
@@ -59,20 +85,87 @@ typedef enum{
     NO_ENOUGH_READINGS  ,
     TEMP_CONTROL_OFF    ,
     COOLER_ON_STATE     ,
-    HEATER_ON_STATE
+    HEATER_ON_STATE     ,
+    IDLE_STATE              // TEMP_DEADBAND: both elements off inside the band
 }TEMP_CONT_T;
 /*****************************************************************************/
 
 /*****************************************************************************
  *
- *  Switch states
+ *  Scheduler events (posted by the ISR, must stay below SCH_MAX_EVENTS)
+ *
+ *****************************************************************************/
+typedef enum{
+    EV_PWR_ON   ,       // external interrupt woke the MCU
+    EV_SW_EDGE  ,       // a debounced switch edge is pending
+    EV_MB_FRAME         // a Modbus request is complete
+}SCH_EVENTS_T;
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Modbus registers
+ *
+ *****************************************************************************/
+typedef enum{
+    MB_HR_DTEMP         ,   // set temperature, MIN_SET_TEMP - MAX_SET_TEMP
+    MB_HR_HEAT_HYST     ,   // heating starts this far below the set temperature, TEMP_HYST_MIN - TEMP_HYST_MAX
+    MB_HR_COOL_HYST     ,   // cooling starts this far above the set temperature, TEMP_HYST_MIN - TEMP_HYST_MAX
+    MB_HR_NUM
+}MB_HOLDING_REGS_T;
+
+typedef enum{
+    MB_IR_TEMP          ,   // current reading
+    MB_IR_AVG_TEMP      ,   // filtered average
+    MB_IR_PWR_MODE      ,
+    MB_IR_OUTPUTS       ,   // TELEM_FLAG_xxx bits
+    MB_IR_SCH_ERROR     ,
+    MB_IR_OVERRUNS      ,   // sum of the task overruns
+    MB_IR_WDT_RESETS    ,
+    MB_IR_STALLED       ,
+    MB_IR_BAD_FRAMES    ,
+    MB_IR_CPU_LOAD      ,   // percent, rolling
+    MB_IR_ISR_LOAD      ,   // percent, last second
+    MB_IR_PEAK_BUSY     ,   // longest dispatcher pass of the last second, TSTAMP_US_PER_TICK units
+    MB_IR_ENERGY_DAY    ,   // Wh of the current day
+    MB_IR_ENERGY_LAST   ,   // Wh of the previous day
+    MB_IR_ENERGY_LO     ,   // lifetime Wh, low word
+    MB_IR_ENERGY_HI     ,   // lifetime Wh, high word
+    MB_IR_NUM
+}MB_INPUT_REGS_T;
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Power manager order, suspend runs from the first to the last and resume
+ *  from the last to the first
  *
  *****************************************************************************/
 typedef enum{
-    SW_DEPRESSED_STATE  ,
-    SW_PRESSED_STATE    ,
-    SW_SET_MODE_PRESSED_STATE
-}SWITCH_STATES_ET;
+    PWR_ORDER_SCH       ,       // no task runs while suspending / started last
+    PWR_ORDER_LOGGER    ,       // records the outputs state before they are off
+    PWR_ORDER_OUTPUTS   ,
+    PWR_ORDER_DISPLAY   ,
+    PWR_ORDER_CONTROL   ,
+    PWR_ORDER_UI        ,
+    PWR_ORDER_SETTINGS          // saved last / nothing to resume
+}PWR_ORDER_T;
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Resume phases (time stamped from the wake up interrupt)
+ *
+ *****************************************************************************/
+typedef enum{
+    RESUME_PH_WAKE      ,       // external interrupt
+    RESUME_PH_HOOKS     ,       // pwr_on() dispatched
+    RESUME_PH_FILTER    ,       // averaging buffer seeded
+    RESUME_PH_CONTROL   ,       // first control decision
+    RESUME_PH_DISPLAY   ,       // frame buffer rendered
+    RESUME_PH_SCH       ,       // scheduler started
+    RESUME_PH_NUM
+}RESUME_PHASE_T;
 /*****************************************************************************/
 
 /*****************************************************************************
@@ -90,10 +183,10 @@ typedef enum{
 /**
  * SSD_UpdateDisp_Task()
  * 
- * @brief This is the task responsible for operating the seven segments display.
- *        A periodic function that is repeated every (n)ms for two displays
- *        every display is refreshed every (2*n)ms. Where n represents the refresh 
- *        period and can be changed from the config file. Two values are displayed
+ * @brief This is the task responsible for the content of the seven segments display.
+ *        A periodic function that is repeated every (n)ms, it updates the SSD
+ *        frame buffer only when the displayed value changes, the digits are
+ *        refreshed by the Timer 2 interrupt. Two values are displayed
  *        (Temperature Reading / Temperature Setting value). At temperature Setting
  *        mode SSDs blinks every (m)s.Where m is the on/off time.
  *
@@ -122,7 +215,9 @@ void Temp_Sense_Task(void);
  *        (Heater / Cooler) based on the average k temperature reading and the set temperature.
  *        A periodic function that is repeated every (n)ms, (n & k) can both be changed from
  *        configuration file.
- *        5 degrees celsius error allowed for the temperature.
+ *        Heating starts (heat hysteresis) below the set temperature and
+ *        cooling (cool hysteresis) above it, with TEMP_DEADBAND both stop at
+ *        the set temperature and the unit idles inside the band.
  *
  * @param <void> a periodic task called by the dispatcher that takes no arguments
  * @return <void>
@@ -130,33 +225,69 @@ void Temp_Sense_Task(void);
 void Temp_Control_Task(void);
 
 /**
- * SetTemp_Task()
+ * Buttons_Event()
  * 
- * @brief This is the task responsible for setting the temperature with a step 
- *        of 5 degrees celsius within the range 35 - 75
- *        first plus or minus switch press enters the setting temperature mode.
- *        Temperature is saved to external EEPROM to be retrieved when the power is disconnected
- *        If there was no interaction with the switch for (n)ms setting mode is turned
- *        off and the display returns to displaying the temperature.
+ * @brief This is the event handler responsible for the switches, it runs when
+ *        the tick ISR posts a debounced switch edge: the first plus or minus
+ *        press enters the setting temperature mode, the next presses step the
+ *        set temperature by 5 degrees celsius within the range 35 - 75, the
+ *        power switch release calls the power off sequence. Plus held in the
+ *        diagnostics mode starts the two point sensor calibration.
+ *
+ * @param <void> an event handler called by the dispatcher that takes no arguments
+ * @return <void>
+ */
+void Buttons_Event(void);
+
+/**
+ * Log_Task()
+ * 
+ * @brief This is the task responsible for the temperature history.
+ *        A periodic function that is repeated every second, every (n)s it adds
+ *        a record of the average temperature, set temperature, actuator
+ *        state and events to the EEPROM logger. n can be changed from
+ *        configuration file. The energy meter is updated every second.
  *
  * @param <void> a periodic task called by the dispatcher that takes no arguments
  * @return <void>
  */
-void SetTemp_Task(void);
+void Log_Task(void);
 
 /**
- * BTN_PwrOFF_Task()
+ * Supply_Monitor_Task()
  * 
- * @brief This is the task responsible for checking the power switch state and calling 
- *        the power off sequence.
- *        A periodic function that is repeated every (n)ms, n can be changed from
- *        configuration file.
- *        MCU shuts Down when the switch is pressed then released
+ * @brief This is the task responsible for the power fail early warning.
+ *        A periodic function that is repeated every (n)ms, it samples the
+ *        supply voltage and calls pwr_fail() when it drops.
  *
  * @param <void> a periodic task called by the dispatcher that takes no arguments
  * @return <void>
  */
-void BTN_PwrOFF_Task(void);
+void Supply_Monitor_Task(void);
+
+/**
+ * Telemetry_Task()
+ *
+ * @brief This is the task responsible for the serial telemetry.
+ *        A periodic function that is repeated every (n)ms, it queues a status
+ *        frame on the USART and serves the single byte host commands.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void Telemetry_Task(void);
+
+/**
+ * pwr_fail()
+ * 
+ * @brief This is the brown-out handler. It turns off the outputs, stops the
+ *        scheduler, saves the unsaved settings with one page write and puts
+ *        the MCU to sleep.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void pwr_fail(void);
 
 /**
  * MC_init()
@@ -180,6 +311,39 @@ void MC_init(void);
  */
 void tasks_creation(void);
 
+/**
+ * resume_mark()
+ * 
+ * @brief This function time stamps a resume phase relative to RESUME_PH_WAKE,
+ *        it is called from the ISR for RESUME_PH_WAKE.
+ *
+ * @param <RESUME_PHASE_T phase> the phase reached
+ * @return <void>
+ */
+void resume_mark(RESUME_PHASE_T phase);
+
+/**
+ * get_resume_time()
+ * 
+ * @brief This function gets the time of a phase of the last resume after the
+ *        wake up interrupt.
+ *
+ * @param <RESUME_PHASE_T phase> the phase
+ * @return <unsigned int> the time in TSTAMP_US_PER_TICK units
+ */
+unsigned int get_resume_time(RESUME_PHASE_T phase);
+
+/**
+ * pwr_hooks_creation()
+ * 
+ * @brief This is a one time call function at the start to register the
+ *        suspend and resume hooks of the modules with the power manager.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void pwr_hooks_creation(void);
+
 /**
  * pwr_off()
  * 
@@ -281,5 +445,16 @@ void set_op_mode(DISP_MOD_T val);
  * @return <void>
  */
 DISP_MOD_T get_op_mode(void);
+
+/**
+ * get_avg_temperature()
+ * 
+ * @brief This function gets the average of the last k temperature readings
+ *        calculated by Temp_Control_Task.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned short>
+ */
+unsigned short get_avg_temperature(void);
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
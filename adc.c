@@ -14,6 +14,8 @@
 *******************************************************************************/
 #include <xc.h>
 #include "adc.h"
+#include "trace.h"
+#include "record.h"
 
 /******************************************************************************
 * Functions
@@ -36,32 +38,30 @@ sch_init()
 -*------------------------------------------------------------------*/
 unsigned int adc_get(unsigned char canal)
 {  
-     switch(canal)
+    static unsigned char last_canal = 0xFF;
+    unsigned char i;
+    unsigned int val;
+
+    ADCON0=0x01|((canal&0x07)<<3);    // select the channel, keep the ADC on
+
+    /* the holding capacitor needs the acquisition time after a channel change */
+    if(canal != last_canal)
     {
-      case 0:
-        ADCON0=0x01;
-        break;
-      case 1:
-        ADCON0=0x09;
-        break;
-      case 2:
-        ADCON0=0x11;
-        break;
-      case 3:
-        ADCON0=0x11;
-        break;
-      case 4:
-        ADCON0=0x11;
-        break;
-      case 5:
-        ADCON0=0x11;
-        break;
-    }   
+      for(i=0;i<ADC_ACQ_LOOPS;i++)
+      {
+        asm("NOP");
+      }
+      last_canal=canal;
+    }
      
+    TRACE(TRACE_ADC_BEGIN, canal);
     ADCON0bits.GO=1;
     while(ADCON0bits.GO == 1);
+    TRACE(TRACE_ADC_END, canal);
 
-   return ((((unsigned int)ADRESH)<<2)|(ADRESL>>6));
+    val = (((unsigned int)ADRESH)<<2)|(ADRESL>>6);
+    REC_ADC(canal, val);
+    return val;
 }
 
 /*------------------------------------------------------------------*
@@ -12,6 +12,11 @@
 
 #ifndef __ADC_H__
 #define __ADC_H__
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define ADC_ACQ_LOOPS   8       // around 20us acquisition time after a channel change
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
@@ -0,0 +1,178 @@
+/****************************************************************************
+* Title                 :   Benchmarks
+* Filename              :   bench.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by BENCH_ENABLE in config_EW_Heater.h
+*******************************************************************************/
+/** \file   bench.c
+ *  \brief  This file contains the cycle measurement of the hot paths.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "bench.h"
+
+#if BENCH_ENABLE
+#include <xc.h>
+#include "tstamp.h"
+#include "tempsensor.h"
+#include "EW_Heater.h"
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+#include "i2c.h"
+#include "eeprom_ext.h"
+#endif
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * (bench_t0) start of the running measurement of every routine, the ISR
+ * and the tasks probe different routines so they never share one.
+ * (bench_max) longest time in Timer 1 ticks, (bench_ovh) the time of an
+ * empty begin / end pair taken off every measurement.
+-*------------------------------------------------------------------*/
+static uint16_t bench_t0[BENCH_NUM];
+static unsigned int bench_max[BENCH_NUM];
+static unsigned int bench_ovh = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * bench_begin()
+ * This function starts the measurement of a routine.
+-*------------------------------------------------------------------*/
+void bench_begin(unsigned char id)
+{
+    bench_t0[id] = tstamp_get();
+}
+
+/*------------------------------------------------------------------*
+ * bench_end()
+ * This function keeps the longest time of a routine.
+-*------------------------------------------------------------------*/
+void bench_end(unsigned char id)
+{
+    uint16_t dt = tstamp_get() - bench_t0[id];
+
+    dt = (dt > bench_ovh) ? dt - bench_ovh : 0;
+    if(dt > bench_max[id])
+    {
+        bench_max[id] = dt;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * bench_call()
+ * Measures BENCH_RUNS calls of a routine with the interrupts held off.
+-*------------------------------------------------------------------*/
+static void bench_call(unsigned char id, void (*fn)(void))
+{
+    unsigned char gie = GIE;
+    unsigned char i;
+
+    GIE = 0;
+    for(i = 0 ; i < BENCH_RUNS ; i++)
+    {
+        bench_begin(id);
+        fn();
+        bench_end(id);
+    }
+    if(gie)
+    {
+        GIE = 1;
+    }
+}
+
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+/*------------------------------------------------------------------*
+ * bench_bus()
+ * i2c_wb() on the control byte and i2c_rb() on the first byte of a read,
+ * the transaction around them is not measured.
+-*------------------------------------------------------------------*/
+static void bench_bus(void)
+{
+    unsigned char i;
+
+    for(i = 0 ; i < BENCH_RUNS ; i++)
+    {
+        i2c_start();
+        bench_begin(BENCH_I2C_WB);
+        i2c_wb(E2PEXT_CTRL(BENCH_E2P_ADDRESS) | 0x01);
+        bench_end(BENCH_I2C_WB);
+        bench_begin(BENCH_I2C_RB);
+        i2c_rb(0);
+        bench_end(BENCH_I2C_RB);
+        i2c_stop();
+    }
+}
+#endif
+
+/*------------------------------------------------------------------*
+ * bench_run()
+ * The probe overhead is measured first. The EEPROM byte is written back
+ * with its own value and the write cycle is waited for outside the
+ * measurement.
+-*------------------------------------------------------------------*/
+void bench_run(void)
+{
+    unsigned char gie = GIE;
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+    unsigned char i, val = 0;
+#endif
+
+    GIE = 0;
+    bench_begin(BENCH_TEMP_UPDATE);
+    bench_end(BENCH_TEMP_UPDATE);
+    bench_ovh = bench_max[BENCH_TEMP_UPDATE];
+    bench_max[BENCH_TEMP_UPDATE] = 0;
+    if(gie)
+    {
+        GIE = 1;
+    }
+
+    bench_call(BENCH_TEMP_UPDATE, temp_update);
+    bench_call(BENCH_SSD_TASK, SSD_UpdateDisp_Task);
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+    GIE = 0;
+    bench_bus();
+    for(i = 0 ; i < BENCH_RUNS ; i++)
+    {
+        bench_begin(BENCH_E2P_R);
+        val = e2pext_r(BENCH_E2P_ADDRESS);
+        bench_end(BENCH_E2P_R);
+    }
+    bench_begin(BENCH_E2P_W);
+    e2pext_w(BENCH_E2P_ADDRESS, val);
+    bench_end(BENCH_E2P_W);
+    e2pext_wait_ready();
+    if(gie)
+    {
+        GIE = 1;
+    }
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * bench_get()
+ * This function gets the longest time of a routine in cycles.
+-*------------------------------------------------------------------*/
+unsigned int bench_get(unsigned char id)
+{
+    unsigned char gie = GIE;
+    unsigned int ret;
+
+    GIE = 0;
+    ret = bench_max[id];
+    if(gie)
+    {
+        GIE = 1;
+    }
+    return (ret > 0xFFFF / BENCH_CYCLES_PER_TICK) ? 0xFFFF : ret * BENCH_CYCLES_PER_TICK;
+}
+#endif
+/*** End of File **************************************************************/
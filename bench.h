@@ -0,0 +1,115 @@
+/****************************************************************************
+* Title                 :   Benchmarks
+* Filename              :   bench.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by BENCH_ENABLE in config_EW_Heater.h
+*******************************************************************************/
+/** \file   bench.h
+ *  \brief  This file contains the cycle measurement of the hot paths and
+ *          their budgets.
+ *
+ *  Every routine keeps the longest time measured with the Timer 1 time
+ *  base (BENCH_CYCLES_PER_TICK instruction cycles resolution), by probes
+ *  in the code (ISR tick branch, dispatcher pass, averaging loop) or by
+ *  bench_run() at start up. The results are sent as TELEM_TYPE_BENCH frames and checked against
+ *  BENCH_BUDGETS on the host by tools/bench_check.c.
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define BENCH_CYCLES_PER_TICK               8       // Timer 1 prescaler 8, Fosc / 4
+#define BENCH_RUNS                          4       // calls per routine in bench_run()
+
+/*------------------------------------------------------------------*
+ * Routines
+-*------------------------------------------------------------------*/
+#define BENCH_ISR_TICK                      0       // Timer 0 branch of ISR()
+#define BENCH_DISPATCH                      1       // SCH_Dispatch_Tasks() pass with its tasks
+#define BENCH_TEMP_UPDATE                   2       // temp_update()
+#define BENCH_TEMP_AVG                      3       // averaging loop of Temp_Control_Task()
+#define BENCH_SSD_TASK                      4       // SSD_UpdateDisp_Task()
+#define BENCH_I2C_WB                        5       // i2c_wb()
+#define BENCH_I2C_RB                        6       // i2c_rb()
+#define BENCH_E2P_R                         7       // e2pext_r()
+#define BENCH_E2P_W                         8       // e2pext_w(), without the write cycle
+#define BENCH_NUM                           9
+
+/*------------------------------------------------------------------*
+ * Budgets in instruction cycles (0.5us at 8MHz), in the routines order.
+ * A dispatcher pass must fit in one tick (SCH_TICK * 2000 cycles).
+ * Regenerate them from a unit with: bench_check -u <device>
+-*------------------------------------------------------------------*/
+#define BENCH_BUDGETS                       { 1000, 10000, 1200, 700, 1200, 600, 700, 2500, 2000 }
+
+/*------------------------------------------------------------------*
+ * Probes, compiled out unless BENCH_ENABLE
+-*------------------------------------------------------------------*/
+#if BENCH_ENABLE
+#define BENCH_BEGIN(id)                     bench_begin(id)
+#define BENCH_END(id)                       bench_end(id)
+#else
+#define BENCH_BEGIN(id)
+#define BENCH_END(id)
+#endif
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * bench_begin()
+ *
+ * @brief This function starts the measurement of a routine. Use the
+ *        BENCH_BEGIN() macro so the call compiles out.
+ *
+ * @param <unsigned char id> the BENCH_xxx routine
+ * @return <void>
+ */
+void bench_begin(unsigned char id);
+
+/**
+ * bench_end()
+ *
+ * @brief This function ends the measurement of a routine and keeps the
+ *        longest one. Use the BENCH_END() macro so the call compiles out.
+ *
+ * @param <unsigned char id> the BENCH_xxx routine
+ * @return <void>
+ */
+void bench_end(unsigned char id);
+
+/**
+ * bench_run()
+ *
+ * @brief This function measures the routines that are not probed while
+ *        running, it is called once after the tasks are created and before
+ *        the first sleep. The interrupts are held off while measuring.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void bench_run(void);
+
+/**
+ * bench_get()
+ *
+ * @brief This function gets the longest time measured for a routine.
+ *
+ * @param <unsigned char id> the BENCH_xxx routine
+ * @return <unsigned int> instruction cycles, 0 if not measured yet
+ */
+unsigned int bench_get(unsigned char id);
+
+#endif
+/*** End of File **************************************************************/
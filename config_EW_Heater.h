@@ -22,9 +22,14 @@
  *
  *****************************************************************************/
 #define SSD_BLINK_PERIOD                    1000
-#define SSD_TASK_PERIOD                     20
+#define SSD_TASK_PERIOD                     100
 #define SSD_TASK_DELAY                      15
-#define SSD_NUM                             2
+#define SSD_NUM                             2       // digits used, 1 - 4
+#define SSD_RIGHT_DIGIT                     1       // board SSD of the right digit (0 = SSD4 ... 3 = SSD1)
+#define SSD_MUX_PR2                         124     // Timer 2 period, 1ms per digit
+#define SSD_BRIGHT_LEVELS                   4       // on time 1/8, 1/4, 1/2, 1 of the digit slot
+#define SSD_BRIGHTNESS                      3       // initial brightness level
+#define SSD_BLANK_TIMEOUT                   10      // minutes without a button press before blanking, 0 = never
 /*****************************************************************************/
 
 
@@ -37,7 +42,12 @@
 #define MAX_SET_TEMP                        75
 #define MIN_SET_TEMP                        35
 #define TEMP_SET_STEP                       5
-#define TEMP_ERROR_VAL                      5
+#define TEMP_ERROR_VAL                      5       // default heat / cool hysteresis
+#define TEMP_HYST_MIN                       1
+#define TEMP_HYST_MAX                       15
+#ifndef TEMP_DEADBAND
+#define TEMP_DEADBAND                       1       // idle inside the band, 0 = heater / cooler cycle
+#endif
 #define TEMP_SENSOR_CH                      2
 #define TEMP_SAVE_ADDRESS                   0x0009
 #define TEMP_SENSE_TASK_PERIOD              100
@@ -45,7 +55,137 @@
 #define TEMP_CONTROL_TASK_PERIOD            100
 #define TEMP_CONTROL_TASK_DELAY             5
 #define TEMP_READINGS_AVG                   10
+#define TEMP_RESUME_SAMPLES                 4       // burst seeding the average at wake up, 0 = off
 #define HEAT_LED_BLINK_TIME                 1000
+#define TEMP_CAL_SHIFT                      10
+#define TEMP_CAL_GAIN_DEFAULT               502     // (100/204) << TEMP_CAL_SHIFT
+#define TEMP_CAL_OFFSET_DEFAULT             0       // signed, 1 / (1 << TEMP_CAL_SHIFT) C
+#define TEMP_CAL_GAIN_MIN                   376     // default - 25%
+#define TEMP_CAL_GAIN_MAX                   628     // default + 25%
+#define TEMP_CAL_OFFSET_MAX                 (10 << TEMP_CAL_SHIFT)  // 10C either way
+#define TEMP_CAL_RAW_SHIFT                  4       // calibration points in 1/16 ADC counts
+#define TEMP_CAL_MIN_SPAN                   10      // C between the two calibration points
+#define TEMP_CAL_TIMEOUT                    300000UL    // calibration dropped without a button press
+#define TEMP_FAULT_RAW_LOW                  4       // ADC counts, about 2C
+#define TEMP_FAULT_RAW_HIGH                 306     // ADC counts, about 150C
+#define TEMP_FAULT_SAMPLES                  3       // readings in a row
+#ifndef TEMP_ADAPT_ENABLE
+#define TEMP_ADAPT_ENABLE                   1       // slow sense / control rate while the tank is stable
+#endif
+#define TEMP_ADAPT_SLOW_PERIOD              2000    // sense and control period while stable
+#define TEMP_ADAPT_WINDOW                   60000   // slope measured over this time (ms)
+#define TEMP_ADAPT_SLOPE                    1       // C per window, more is not stable
+#define TEMP_ADAPT_ERROR                    3       // C from the set temperature, more is not stable
+#define TEMP_ADAPT_DRAW                     2       // C a reading is below the average on a water draw
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Supply Monitor (power fail early warning)
+ *
+ *****************************************************************************/
+#define SUPPLY_SENSE_CH                     1
+#define SUPPLY_LOW_THRESHOLD                600     // ADC counts, nominal supply reads ~800
+#define SUPPLY_LOW_SAMPLES                  2
+#define SUPPLY_TASK_PERIOD                  5
+#define SUPPLY_TASK_DELAY                   0
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Storage backend
+ *      STORAGE_BACKEND_E2PEXT  external 24C04, 512 bytes
+ *      STORAGE_BACKEND_INT     PIC internal data EEPROM, 256 bytes, no I2C traffic,
+ *                              writes block ~4ms per byte (~64ms per page), so
+ *                              pwr_fail() only saves the settings page
+ *      STORAGE_BACKEND_FILE    file backed mock for host builds (tools/host)
+ *
+ *****************************************************************************/
+#define STORAGE_BACKEND_E2PEXT              0
+#define STORAGE_BACKEND_INT                 1
+#define STORAGE_BACKEND_FILE                2
+#ifndef STORAGE_BACKEND
+#define STORAGE_BACKEND                     STORAGE_BACKEND_E2PEXT
+#endif
+#define STORAGE_FILE_NAME                   "eeprom.bin"
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Settings Store (storage region, one page per slot)
+ *
+ *****************************************************************************/
+#if STORAGE_BACKEND == STORAGE_BACKEND_INT
+#define SETTINGS_START_ADDRESS              0x0080
+#else
+#define SETTINGS_START_ADDRESS              0x0180
+#endif
+#define SETTINGS_SLOTS                      8
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Temperature Logger (storage ring, one page per 6 records)
+ *  note: LOG_PAGES must not be a multiple of 256 (sequence byte)
+ *
+ *****************************************************************************/
+#define LOG_START_ADDRESS                   0x0010
+#if STORAGE_BACKEND == STORAGE_BACKEND_INT
+#define LOG_PAGES                           7
+#else
+#define LOG_PAGES                           23
+#endif
+#define LOG_INTERVAL                        300     // seconds between two records
+#define LOG_TASK_PERIOD                     1000
+#define LOG_TASK_DELAY                      25
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Energy Meter (sampled every second by the log task)
+ *      ENERGY_SRC_RATING   element ratings while they are on
+ *      ENERGY_SRC_ADC      current transducer (DC output) on a spare channel
+ *  note: the power must stay below 65535 - 3600 W
+ *
+ *****************************************************************************/
+#define ENERGY_SRC_RATING                   0
+#define ENERGY_SRC_ADC                      1
+#define ENERGY_SOURCE                       ENERGY_SRC_RATING
+#define HEATER_POWER_W                      2000
+#define COOLER_POWER_W                      150
+#define ENERGY_ADC_CH                       0       // AN0, analog with ADCON1 = 0x02
+#define ENERGY_ADC_W_PER_COUNT              5       // 1023 counts = 5115W
+#define ENERGY_SAVE_INTERVAL                3600    // seconds between two lifetime counter commits
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Serial port (USART 8N1, SPBRG = Fosc / (16 * baud) - 1 with BRGH = 1)
+ *      SERIAL_PROTOCOL_TELEM   framed telemetry stream, see telem.h
+ *      SERIAL_PROTOCOL_MODBUS  Modbus RTU slave, see modbus.h
+ *      SERIAL_PROTOCOL_RECORD  input record stream for tools/replay, see record.h
+ *  note: ring sizes are powers of 2, a telemetry frame needs TELEM_ST_SIZE + 4
+ *        bytes, a Modbus request up to 9 + 2 * MODBUS_MAX_REGS bytes
+ *
+ *****************************************************************************/
+#define SERIAL_PROTOCOL_TELEM               0
+#define SERIAL_PROTOCOL_MODBUS              1
+#define SERIAL_PROTOCOL_RECORD              2
+#ifndef SERIAL_PROTOCOL
+#define SERIAL_PROTOCOL                     SERIAL_PROTOCOL_TELEM
+#endif
+#define USART_SPBRG                         25      // 19200 baud at 8MHz
+#define USART_TX_SIZE                       32
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+#define USART_RX_SIZE                       32
+#else
+#define USART_RX_SIZE                       8
+#endif
+#define TELEM_TASK_PERIOD                   1000
+#define TELEM_TASK_DELAY                    35
+#define MODBUS_ADDRESS                      1
+#define MODBUS_MAX_REGS                     4       // per request
+#define MODBUS_T35_US                       1823    // 3.5 characters of 10 bits at 19200 baud
 /*****************************************************************************/
 
 /*****************************************************************************
@@ -53,26 +193,61 @@
  *  Temperature Setting
  *
  *****************************************************************************/
-#define TEMP_SET_TASK_PERIOD                50
-#define TEMP_SET_TASK_DELAY                 10
 #define TEMP_SET_TIMEOUT                    5000
 /*****************************************************************************/
 
 /*****************************************************************************
  *
- *  Switches
+ *  Diagnostics display (plus and minus held together for SW_LONG_PRESS_TIME
+ *  enter / leave it, plus / minus select the next / previous page)
+ *
+ *****************************************************************************/
+#define DIAG_TIMEOUT                        60000   // back to the temperature without interaction
+#define DIAG_NAME_TIME                      1000    // page name "d<n>" shown after a page change
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Event Trace (RAM ring of TRACE_BUF_SIZE * 4 bytes, power of 2)
+ *  note: ISR tracing fills the ring within a few ms
+ *
+ *****************************************************************************/
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE                        0
+#endif
+#define TRACE_ISR                           0
+#define TRACE_BUF_SIZE                      16
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Benchmarks (cycle budgets in bench.h, checked by tools/bench_check)
+ *  note: bench_run() rewrites the byte at BENCH_E2P_ADDRESS with its own value
+ *
+ *****************************************************************************/
+#ifndef BENCH_ENABLE
+#define BENCH_ENABLE                        0
+#endif
+#define BENCH_E2P_ADDRESS                   0x0000  // unused, below TEMP_SAVE_ADDRESS
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Power Manager
+ *
+ *****************************************************************************/
+#define PWRMGR_MAX_HOOKS                    8
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Switches (debounced by the tick ISR, 4 ticks)
  *
  *****************************************************************************/
-#define PWR_TASK_PERIOD                     50
-#define PWR_TASK_DELAY                      20
-#define PWR_ON_TASKS_CNT                    2
-#define PLUS_SW                             RB2
-#define MINUS_SW                            RB1
-#define PWR_SW                              RB0
-#define NO_SW_NUM                           0
-#define MINUS_SW_NUM                        1
-#define PLUS_SW_NUM                         2
-#define PWR_SW_NUM                          3
+#define SW_LONG_PRESS_TIME                  1500
+#define PLUS_SW_MSK                         SW2_MSK
+#define MINUS_SW_MSK                        SW1_MSK
+#define PWR_SW_MSK                          SW0_MSK
 /*****************************************************************************/
 
 #endif
@@ -49,4 +49,13 @@ void cooler_off(void)
         COOLER_PORT &= ~COOLER_MSK;
     }
 }
+
+/*------------------------------------------------------------------*
+ * cooler_is_on()
+ * This function returns 1 if the cooler is turned on and 0 if it is turned off.
+-*------------------------------------------------------------------*/
+unsigned char cooler_is_on(void)
+{
+    return ((COOLER_PORT&COOLER_MSK) != 0);
+}
 /*** End of File **************************************************************/
\ No newline at end of file
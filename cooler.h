@@ -46,5 +46,15 @@ void cooler_on(void);
  */
 void cooler_off(void);
 
+/**
+ * cooler_is_on()
+ * 
+ * @brief This function returns 1 if the cooler is turned on and 0 if it is turned off.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char>
+ */
+unsigned char cooler_is_on(void);
+
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -0,0 +1,51 @@
+/****************************************************************************
+* Title                 :   CRC
+* Filename              :   crc.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   None
+*******************************************************************************/
+/** \file   crc.h
+ *  \brief  This file contains the checksum functions used to protect the data
+ *          saved to the EEPROM and the serial frames.
+ */
+
+#ifndef __CRC_H__
+#define __CRC_H__
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define CRC8_POLY           0x07
+#define CRC8_INIT           0xFF    // non zero so a cleared record never passes the check
+#define CRC16_INIT          0xFFFF  // Modbus RTU, polynomial 0xA001 (reflected 0x8005)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * crc8()
+ *
+ * @brief This function calculates the CRC-8 (polynomial x^8+x^2+x+1) of a buffer.
+ *
+ * @param <const unsigned char *buf> the data to be checked
+ * @param <unsigned char len> the number of bytes in the buffer
+ * @return <unsigned char> the calculated CRC
+ */
+unsigned char crc8(const unsigned char *buf, unsigned char len);
+
+/**
+ * crc16()
+ *
+ * @brief This function calculates the Modbus RTU CRC-16 of a buffer, the
+ *        low byte is sent first.
+ *
+ * @param <const unsigned char *buf> the data to be checked
+ * @param <unsigned char len> the number of bytes in the buffer
+ * @return <unsigned int> the calculated CRC
+ */
+unsigned int crc16(const unsigned char *buf, unsigned char len);
+
+#endif
+/*** End of File **************************************************************/
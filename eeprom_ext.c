@@ -15,6 +15,17 @@
 *******************************************************************************/
 #include "i2c.h"
 #include"eeprom_ext.h"
+#include "trace.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * (e2pext_errors) ACK polls that timed out and bytes the device did not
+ * acknowledge once it answered its control byte, saturated. The polls of
+ * a normal write cycle (tWR) are not counted.
+-*------------------------------------------------------------------*/
+static unsigned int e2pext_errors = 0;
 
 /******************************************************************************
 * Functions
@@ -30,76 +41,185 @@ void e2pext_init(void)
 }
 
 /*------------------------------------------------------------------*
- * unsigned char e2pext_r(unsigned int addr)
- * This function reads the data from the address(addr).
+ * e2pext_error()
+ * This function counts a bus error.
 -*------------------------------------------------------------------*/
-unsigned char e2pext_r(unsigned int addr)
+static void e2pext_error(void)
 {
-  unsigned char ret;
-  unsigned char ah;
-  unsigned char al;
-
-  ah=(addr&0x0100)>>8;
-  al=addr&0x00FF;
-  i2c_start();	
-  if(ah)
-  {
-    i2c_wb(0xA2);
-  }
-  else
+  if(e2pext_errors < 0xFFFF)
   {
-    i2c_wb(0xA0);
+    e2pext_errors++;
   }
-  i2c_wb(al);
+}
 
-  i2c_start();
-  if(ah)
-  {
-    i2c_wb(0xA3);
-  }
-  else
+/*------------------------------------------------------------------*
+ * unsigned char e2pext_select(unsigned int addr)
+ * This function addresses the eeprom block holding (addr) and sends the word
+ * address. While an internal write cycle (tWR) is still running the device
+ * does not acknowledge its control byte, so the start is repeated until it
+ * answers (ACK polling) instead of waiting a fixed worst case time.
+-*------------------------------------------------------------------*/
+static unsigned char e2pext_select(unsigned int addr)
+{
+  unsigned char ctrl;
+  unsigned char nt;
+
+  ctrl=E2PEXT_CTRL(addr);
+  nt=0;
+
+  do
   {
-    i2c_wb(0xA1);
+    CLRWDT();           /* a memory still writing is progress */
+    i2c_start();
+    if(i2c_wb(ctrl) == I2C_ACK)
+    {
+      if(i2c_wb(addr&0x00FF) != I2C_ACK)
+      {
+        e2pext_error();
+      }
+      return E2PEXT_OK;
+    }
+    nt++;
   }
-  ret=i2c_rb(1);
-  i2c_stop();
+  while(nt < E2PEXT_ACK_POLL_MAX);
 
-  return ret;	
+  i2c_stop();
+  e2pext_error();
+  return E2PEXT_TIMEOUT;
 }
 
 /*------------------------------------------------------------------*
- * e2pext_w(unsigned int addr, unsigned char val)
- * This function writes data(val) to address(addr).
+ * unsigned char e2pext_wait_ready(void)
+ * This function blocks until the last write cycle is finished.
 -*------------------------------------------------------------------*/
-void e2pext_w(unsigned int addr, unsigned char val)
+unsigned char e2pext_wait_ready(void)
 {
-  unsigned int tmp;
-  unsigned char ah;
-  unsigned char al;
-  unsigned char nt;
+  unsigned char ret;
 
-  tmp=val;
-  ah=(addr&0x0100)>>8;
-  al=addr&0x00FF;
-  nt=0;
+  ret=e2pext_select(0x0000);
+  i2c_stop();
 
-  do
+  return ret;
+}
+
+/*------------------------------------------------------------------*
+ * unsigned char e2pext_read_block(unsigned int addr, unsigned char *buf, unsigned char len)
+ * This function reads (len) bytes starting at (addr) using sequential reads,
+ * the device address is only sent again when the read crosses the 256 byte
+ * block boundary (0xA0 / 0xA2).
+-*------------------------------------------------------------------*/
+unsigned char e2pext_read_block(unsigned int addr, unsigned char *buf, unsigned char len)
+{
+  unsigned int chunk;
+  unsigned int i;
+
+  TRACE(TRACE_I2C_BEGIN, len);
+  while(len)
   {
+    chunk=E2PEXT_BLOCK_SIZE-(addr&(E2PEXT_BLOCK_SIZE-1));
+    if(chunk > len)
+    {
+      chunk=len;
+    }
+
+    if(e2pext_select(addr) != E2PEXT_OK)
+    {
+      TRACE(TRACE_I2C_END, 0);
+      return E2PEXT_TIMEOUT;
+    }
     i2c_start();
-    if(ah)
-    { 
-      i2c_wb(0xA2);
+    if(i2c_wb(E2PEXT_CTRL(addr)|0x01) != I2C_ACK)
+    {
+      e2pext_error();
     }
-    else
+    for(i=0;i<chunk;i++)
     {
-      i2c_wb(0xA0);
+      buf[i]=i2c_rb(i != (chunk-1));  // ACK every byte but the last one
     }
-    i2c_wb(al);
-    i2c_wb(tmp);
     i2c_stop();
 
-    nt++;
+    addr+=chunk;
+    buf+=chunk;
+    len-=chunk;
   }
-  while((tmp != e2pext_r(addr))&&(nt < 10));
+
+  TRACE(TRACE_I2C_END, 0);
+  return E2PEXT_OK;
+}
+
+/*------------------------------------------------------------------*
+ * unsigned char e2pext_write_block(unsigned int addr, const unsigned char *buf, unsigned char len)
+ * This function writes (len) bytes starting at (addr) as page writes, the
+ * data is split on the 16 byte page boundaries. The function returns as soon
+ * as the last page is sent, the write cycle completion is detected by the
+ * ACK polling of the next access.
+-*------------------------------------------------------------------*/
+unsigned char e2pext_write_block(unsigned int addr, const unsigned char *buf, unsigned char len)
+{
+  unsigned char chunk;
+  unsigned char i;
+
+  TRACE(TRACE_I2C_BEGIN, len);
+  while(len)
+  {
+    chunk=E2PEXT_PAGE_SIZE-(addr&(E2PEXT_PAGE_SIZE-1));
+    if(chunk > len)
+    {
+      chunk=len;
+    }
+
+    if(e2pext_select(addr) != E2PEXT_OK)
+    {
+      TRACE(TRACE_I2C_END, 0);
+      return E2PEXT_TIMEOUT;
+    }
+    for(i=0;i<chunk;i++)
+    {
+      if(i2c_wb(buf[i]) != I2C_ACK)
+      {
+        e2pext_error();
+      }
+    }
+    i2c_stop();                         // the internal write cycle starts here
+
+    addr+=chunk;
+    buf+=chunk;
+    len-=chunk;
+  }
+
+  TRACE(TRACE_I2C_END, 0);
+  return E2PEXT_OK;
+}
+
+/*------------------------------------------------------------------*
+ * unsigned char e2pext_r(unsigned int addr)
+ * This function reads the data from the address(addr).
+-*------------------------------------------------------------------*/
+unsigned char e2pext_r(unsigned int addr)
+{
+  unsigned char ret;
+
+  ret=0xFF;
+  e2pext_read_block(addr,&ret,1);
+
+  return ret;
+}
+
+/*------------------------------------------------------------------*
+ * e2pext_w(unsigned int addr, unsigned char val)
+ * This function writes data(val) to address(addr).
+-*------------------------------------------------------------------*/
+void e2pext_w(unsigned int addr, unsigned char val)
+{
+  e2pext_write_block(addr,&val,1);
+}
+
+/*------------------------------------------------------------------*
+ * unsigned int e2pext_get_errors(void)
+ * This function gets the bus errors.
+-*------------------------------------------------------------------*/
+unsigned int e2pext_get_errors(void)
+{
+  return e2pext_errors;
 }
-/*** End of File **************************************************************/
\ No newline at end of file
+/*** End of File **************************************************************/
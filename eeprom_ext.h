@@ -16,6 +16,20 @@
 *******************************************************************************/
 #include <xc.h>
 
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define E2PEXT_SIZE             512     // 24C04 capacity in bytes
+#define E2PEXT_BLOCK_SIZE       256     // bytes addressed by one device address (0xA0 / 0xA2)
+#define E2PEXT_PAGE_SIZE        16      // bytes written by one page write
+#define E2PEXT_ACK_POLL_MAX     250     // ACK polls before giving up (covers the 5ms tWR)
+
+#define E2PEXT_OK               0
+#define E2PEXT_TIMEOUT          1
+
+/* Device address (write) of the 256 byte block holding addr */
+#define E2PEXT_CTRL(addr)       (0xA0|(((addr)>>7)&0x02))
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
@@ -51,5 +65,52 @@ unsigned char e2pext_r(unsigned int addr);
  */
 void e2pext_w(unsigned int addr, unsigned char val);
 
+/**
+ * unsigned char e2pext_read_block(unsigned int addr, unsigned char *buf, unsigned char len);
+ * 
+ * @brief This function reads (len) bytes starting at (addr) with sequential reads.
+ *
+ * @param <unsigned int addr> the eeprom address of the first byte.
+ * @param <unsigned char *buf> the buffer the data is copied to.
+ * @param <unsigned char len> the number of bytes to read.
+ * @return <unsigned char> E2PEXT_OK or E2PEXT_TIMEOUT if the device did not answer.
+ */
+unsigned char e2pext_read_block(unsigned int addr, unsigned char *buf, unsigned char len);
+
+/**
+ * unsigned char e2pext_write_block(unsigned int addr, const unsigned char *buf, unsigned char len);
+ * 
+ * @brief This function writes (len) bytes starting at (addr) with 16 byte page writes.
+ *
+ * @param <unsigned int addr> the eeprom address of the first byte.
+ * @param <const unsigned char *buf> the data needed to be saved.
+ * @param <unsigned char len> the number of bytes to write.
+ * @return <unsigned char> E2PEXT_OK or E2PEXT_TIMEOUT if the device did not answer.
+ */
+unsigned char e2pext_write_block(unsigned int addr, const unsigned char *buf, unsigned char len);
+
+/**
+ * unsigned char e2pext_wait_ready(void);
+ * 
+ * @brief This function blocks until the eeprom finished its last write cycle (ACK polling).
+ *
+ * @param <void> none
+ * @return <unsigned char> E2PEXT_OK or E2PEXT_TIMEOUT if the device did not answer.
+ */
+unsigned char e2pext_wait_ready(void);
+
+/**
+ * unsigned int e2pext_get_errors(void);
+ * 
+ * @brief This function gets the bus errors since the reset, saturated at
+ *        0xFFFF: ACK polls that timed out and address or data bytes the
+ *        eeprom did not acknowledge. The polls of a normal write cycle are
+ *        not errors.
+ *
+ * @param <void> none
+ * @return <unsigned int> the number of errors.
+ */
+unsigned int e2pext_get_errors(void);
+
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -0,0 +1,142 @@
+/****************************************************************************
+* Title                 :   Energy Meter
+* Filename              :   energy.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Source, ratings and save interval can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   energy.c
+ *  \brief  This file contains the energy meter of the heater and cooler
+ *          elements.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+#include "energy.h"
+#include "settings.h"
+#if ENERGY_SOURCE == ENERGY_SRC_ADC
+#include "adc.h"
+#else
+#include "heater.h"
+#include "cooler.h"
+#endif
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static unsigned int energy_ws = 0;          // Ws not yet counted as a whole Wh
+static unsigned int day_wh = 0;
+static unsigned int last_day_wh = 0;
+static unsigned long total_wh = 0;
+static unsigned long day_sec = 0;
+static unsigned int save_sec = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * energy_power()
+ * This function gets the power drawn now in watts.
+-*------------------------------------------------------------------*/
+static unsigned int energy_power(void)
+{
+#if ENERGY_SOURCE == ENERGY_SRC_ADC
+    return adc_get(ENERGY_ADC_CH) * ENERGY_ADC_W_PER_COUNT;
+#else
+    unsigned int watts = 0;
+
+    if(heater_is_on())
+    {
+        watts += HEATER_POWER_W;
+    }
+    if(cooler_is_on())
+    {
+        watts += COOLER_POWER_W;
+    }
+    return watts;
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * energy_init()
+ * This function loads the lifetime counter from the settings.
+-*------------------------------------------------------------------*/
+void energy_init(void)
+{
+    total_wh = ((unsigned long)settings_get(SET_KEY_ENERGY_HI) << 16) | settings_get(SET_KEY_ENERGY_LO);
+    energy_ws = 0;
+    day_wh = 0;
+    day_sec = 0;
+    save_sec = 0;
+}
+
+/*------------------------------------------------------------------*
+ * energy_update()
+ * This function adds the energy of the last second. The settings are only
+ * changed in RAM here, the page write is done once every
+ * ENERGY_SAVE_INTERVAL so the EEPROM is not worn by a running heater.
+-*------------------------------------------------------------------*/
+void energy_update(void)
+{
+    unsigned char changed = 0;
+
+    energy_ws += energy_power();
+    while(energy_ws >= ENERGY_WS_PER_WH)
+    {
+        energy_ws -= ENERGY_WS_PER_WH;
+        if(day_wh < 0xFFFF)
+        {
+            day_wh++;
+        }
+        total_wh++;
+        changed = 1;
+    }
+    if(changed)
+    {
+        settings_set(SET_KEY_ENERGY_LO, (unsigned int)total_wh);
+        settings_set(SET_KEY_ENERGY_HI, (unsigned int)(total_wh >> 16));
+    }
+    if(++day_sec >= ENERGY_DAY_SECONDS)
+    {
+        day_sec = 0;
+        last_day_wh = day_wh;
+        day_wh = 0;
+    }
+    if(++save_sec >= ENERGY_SAVE_INTERVAL)
+    {
+        save_sec = 0;
+        settings_commit();                  // No write if nothing changed
+    }
+}
+
+/*------------------------------------------------------------------*
+ * energy_get_day()
+ * This function gets the energy of the current day.
+-*------------------------------------------------------------------*/
+unsigned int energy_get_day(void)
+{
+    return day_wh;
+}
+
+/*------------------------------------------------------------------*
+ * energy_get_last_day()
+ * This function gets the energy of the previous day.
+-*------------------------------------------------------------------*/
+unsigned int energy_get_last_day(void)
+{
+    return last_day_wh;
+}
+
+/*------------------------------------------------------------------*
+ * energy_get_total()
+ * This function gets the lifetime energy.
+-*------------------------------------------------------------------*/
+unsigned long energy_get_total(void)
+{
+    return total_wh;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,90 @@
+/****************************************************************************
+* Title                 :   Energy Meter
+* Filename              :   energy.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Source, ratings and save interval can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   energy.h
+ *  \brief  This file contains the energy meter of the heater and cooler
+ *          elements.
+ *
+ *  The power drawn is taken once a second, from the element ratings while
+ *  they are on (ENERGY_SRC_RATING) or from a current transducer on a spare
+ *  ADC channel (ENERGY_SRC_ADC), and is added up in watt seconds. Whole Wh
+ *  go to the daily and the lifetime counters. The lifetime counter is kept
+ *  in the settings store (SET_KEY_ENERGY_LO / HI), it is committed at most
+ *  once every ENERGY_SAVE_INTERVAL and by the power off / power fail hooks
+ *  that already commit the settings.
+ *  note: there is no real time clock, a day is 24 hours of running time
+ *        (the MCU does not count while it sleeps at power off).
+ */
+
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define ENERGY_WS_PER_WH                    3600
+#define ENERGY_DAY_SECONDS                  86400UL
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * energy_init()
+ *
+ * @brief This function loads the lifetime counter from the settings, it is
+ *        called after settings_init().
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void energy_init(void);
+
+/**
+ * energy_update()
+ *
+ * @brief This function adds the energy of the last second to the counters,
+ *        it is called once a second.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void energy_update(void);
+
+/**
+ * energy_get_day()
+ *
+ * @brief This function gets the energy of the current day.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int> Wh, saturates at 65535
+ */
+unsigned int energy_get_day(void);
+
+/**
+ * energy_get_last_day()
+ *
+ * @brief This function gets the energy of the previous (complete) day.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int> Wh, saturates at 65535
+ */
+unsigned int energy_get_last_day(void);
+
+/**
+ * energy_get_total()
+ *
+ * @brief This function gets the lifetime energy.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned long> Wh
+ */
+unsigned long energy_get_total(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -37,10 +37,12 @@ void init_ext_int(void)
 
 /*------------------------------------------------------------------*
  * ext_int_en()
- * Enables the external interrupt
+ * Enables the external interrupt, an edge seen while it was disabled is
+ * dropped first so it does not wake the MCU at once.
 -*------------------------------------------------------------------*/ 
 void ext_int_en(void)
 {
+    INTF = 0;
     INTE = 1;
 }
 
@@ -53,4 +53,13 @@ void heater_off(void)
         HEATER_PORT &= ~HEATER_MSK;
     }
 }
+
+/*------------------------------------------------------------------*
+ * heater_is_on()
+ * This function returns 1 if the heater is turned on and 0 if it is turned off.
+-*------------------------------------------------------------------*/
+unsigned char heater_is_on(void)
+{
+    return ((HEATER_PORT&HEATER_MSK) != 0);
+}
 /*** End of File **************************************************************/
\ No newline at end of file
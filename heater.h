@@ -47,5 +47,15 @@ void heater_on(void);
  */
 void heater_off(void);
 
+/**
+ * heater_is_on()
+ * 
+ * @brief This function returns 1 if the heater is turned on and 0 if it is turned off.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char>
+ */
+unsigned char heater_is_on(void);
+
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -69,12 +69,14 @@ void i2c_stop(void)
 }
 
 /*------------------------------------------------------------------*
- * i2c_wb(unsigned char val)
- * This function writes data to the i2c connected device.
+ * unsigned char i2c_wb(unsigned char val)
+ * This function writes data to the i2c connected device and samples the
+ * acknowledge bit on the ninth clock (I2C_ACK when the device answered).
 -*------------------------------------------------------------------*/
-void i2c_wb(unsigned char val)
+unsigned char i2c_wb(unsigned char val)
 {
   unsigned char i;
+  unsigned char ack;
   ICLK=0;
   for(i=0;i<8;i++)
   {
@@ -82,12 +84,17 @@ void i2c_wb(unsigned char val)
     ICLK=1;
     delay();
     ICLK=0;
-  }	
+  }
   IDAT=1;
+  TIDAT=1;
   delay();
   ICLK=1;
   delay();
+  ack=IDAT;
   ICLK=0;
+  TIDAT=0;
+
+  return ack;
 }
 
 /*------------------------------------------------------------------*
@@ -24,6 +24,9 @@
 #define IDAT PORTCbits.RC4
 #define TIDAT TRISCbits.TRISC4
 
+#define I2C_ACK  0
+#define I2C_NACK 1
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
@@ -59,14 +62,14 @@ void i2c_start(void);
 void i2c_stop(void);
 
 /**
- * i2c_wb(unsigned char val)
+ * unsigned char i2c_wb(unsigned char val)
  * 
  * @brief This function writes data to the i2c connected device.
  *
- * @param <void>
- * @return <void>
+ * @param <unsigned char val> the byte to be sent on the bus.
+ * @return <unsigned char> I2C_ACK if the device acknowledged the byte, I2C_NACK otherwise.
  */
-void i2c_wb(unsigned char val);
+unsigned char i2c_wb(unsigned char val);
 
 /**
  * unsigned char i2c_rb(unsigned char ack
@@ -16,16 +16,18 @@
 *******************************************************************************/
 #include <xc.h>
 #include "int.h"
+#include "port.h"
 #include "sch.h"
 #include "ext_int.h"
+#include "ssd.h"
+#include "sw.h"
+#include "trace.h"
+#include "usart.h"
+#include "modbus.h"
+#include "record.h"
+#include "bench.h"
 #include "EW_Heater.h"
 
-/******************************************************************************
-* Variables
-*******************************************************************************/
-extern sTask SCH_tasks_G[SCH_MAX_TASKS];        // related to scheduler ISR implementation
-extern unsigned char Error_code_G;              // related to scheduler ISRimplementation
-
 /*------------------------------------------------------------------*
  * Enable_Global_INT()
  * Enables the global interrupt
@@ -67,7 +69,12 @@ void Disable_Perephiral_INT(void)
  * ISR function implementation
 -*------------------------------------------------------------------*/
 void __interrupt() ISR()
-{   PORTE |= 0x01;
+{
+    DEBUG_PORT |= DEBUG_ISR_MSK;    // high while the ISR runs, for a scope
+#if SCH_LOAD_ENABLE
+    SCH_ISR_Enter();        // ISR time of the load meter
+#endif
+    TRACE_IN_ISR(TRACE_ISR_BEGIN, 0);
     /*------------------------------------------------------------------*
      * This is the scheduler ISR. It is called at a rate determined by the timer settings in the 'init' function.
      * This version is triggered by Timer 2 interrupts: timer is automatically reloaded.
@@ -76,38 +83,70 @@ void __interrupt() ISR()
     {
         TMR0 = 100;
         TMR0IF = 0;
-        unsigned char Index;
-        for (Index = 0; Index < SCH_MAX_TASKS ; Index++) 
+        BENCH_BEGIN(BENCH_ISR_TICK);
+        REC_TICK();
+        SCH_Update();           // mark the due tasks and kick the watchdog
+        /* sample and debounce the switches once per tick, wake the buttons handler on an edge */
+        if(sw_debounce_isr())
+        {
+            SCH_Post_Event(EV_SW_EDGE);
+        }
+        BENCH_END(BENCH_ISR_TICK);
+    }
+    /*------------------------------------------------------------------*
+     * This is the display multiplexing ISR. It is called every 1ms by Timer 2
+     * and strobes the next seven segment digit from the frame buffer.
+    -*------------------------------------------------------------------*/ 
+    if(TMR2IF==1 && TMR2IE==1)
+    {
+        TMR2IF = 0;
+        ssd_mux_isr();
+    }
+    /*------------------------------------------------------------------*
+     * This is the USART ISR. TXIF is set whenever TXREG is empty so it is
+     * only served while usart_write() has TXIE enabled.
+    -*------------------------------------------------------------------*/ 
+    if(TXIF==1 && TXIE==1)
+    {
+        usart_tx_isr();
+    }
+    if(RCIF==1)
+    {
+        usart_rx_isr();
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+        mb_rx_isr();        // restart the 3.5 character timer
+#endif
+    }
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_MODBUS
+    /*------------------------------------------------------------------*
+     * This is the Modbus frame gap ISR. CCP1 matches Timer 1 once the line
+     * was silent for 3.5 characters after the last byte.
+    -*------------------------------------------------------------------*/ 
+    if(CCP1IF==1 && CCP1IE==1)
+    {
+        if(mb_t35_isr())
         {
-        // Check if there is a task at this location 
-            if (SCH_tasks_G[Index].pTask) { 
-                if (SCH_tasks_G[Index].Delay == 0) 
-                { 
-                    // The task is due to run 
-                    SCH_tasks_G[Index].RunMe += 1; // Inc. the 'RunMe' flag
-                        if (SCH_tasks_G[Index].Period) 
-                        { 
-                            // Schedule periodic tasks to run again 
-                            SCH_tasks_G[Index].Delay = SCH_tasks_G[Index].Period; 
-                        } 
-                } 
-                else { 
-                    // Not yet ready to run: just decrement the delay 
-                    SCH_tasks_G[Index].Delay -= 1; 
-                } 
-            } 
+            SCH_Post_Event(EV_MB_FRAME);
         }
     }
+#endif
     /*------------------------------------------------------------------*
      * This is the external interrupt ISR. It is called when the device in sleep mode
-     * at the rising edge if the switch.
+     * at the rising edge if the switch. The power on sequence is run by the
+     * dispatcher, not inside the ISR.
     -*------------------------------------------------------------------*/ 
-    if (INTF==1)            //External Interrupt detected
+    if (INTF==1 && INTE==1) //External Interrupt detected
     {
         clear_int_flag();   // Clear external interrupt flag
         ext_int_dis();      // disable External Interrupt
-        pwr_on();           // Start power on sequence
+        REC_INT();
+        resume_mark(RESUME_PH_WAKE);
+        SCH_Post_Event(EV_PWR_ON);
     }
-    PORTE &= ~0x01;
+    TRACE_IN_ISR(TRACE_ISR_END, 0);
+#if SCH_LOAD_ENABLE
+    SCH_ISR_Exit();
+#endif
+    DEBUG_PORT &= ~DEBUG_ISR_MSK;
 }
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -0,0 +1,148 @@
+/****************************************************************************
+* Title                 :   Temperature Logger
+* Filename              :   logger.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Region and interval can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   logger.c
+ *  \brief  This file contains the temperature history logger kept in a ring
+ *          of pages in the non volatile storage.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "crc.h"
+#include "logger.h"
+
+#if (LOG_PAGES % 256) == 0
+#error "LOG_PAGES is a multiple of 256, an old page would look like the next one"
+#endif
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * static unsigned char (log_page) is the page being filled in RAM
+ * static unsigned char (log_rec) is the number of records in log_page
+ * static unsigned char (log_prev) is the temperature of the last record
+ * static unsigned char (log_next) is the ring page log_page will be written to
+ * static unsigned char (log_seq) is the sequence number of log_page
+ * static unsigned char (log_events) are the events since the last record
+-*------------------------------------------------------------------*/
+static unsigned char log_page[LOG_PAGE_SIZE];
+static unsigned char log_rec = 0;
+static unsigned char log_prev = 0;
+static unsigned char log_next = 0;
+static unsigned char log_seq = 0;
+static unsigned char log_events = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * logger_init()
+ * This function reads the sequence byte of the ring pages in order, the
+ * newest page is the last one followed by its sequence number plus one.
+ * The sequence of an old page is LOG_PAGES behind its neighbour, so it
+ * never looks like the next one unless LOG_PAGES is a multiple of 256.
+-*------------------------------------------------------------------*/
+void logger_init(void)
+{
+    unsigned char page;
+    unsigned char seq;
+
+    log_seq = storage_r(LOG_PAGE_ADDRESS(0));
+    for(page = 1 ; page < LOG_PAGES ; page++)
+    {
+        seq = storage_r(LOG_PAGE_ADDRESS(page));
+        if(seq != (unsigned char)(log_seq + 1))
+        {
+            break;
+        }
+        log_seq = seq;
+    }
+    log_next = (page < LOG_PAGES) ? page : 0;
+    log_seq++;
+    log_rec = 0;
+    log_events = 0;
+}
+
+/*------------------------------------------------------------------*
+ * logger_add(unsigned char temp, unsigned char dtemp, unsigned char state)
+ * This function appends a delta encoded record to the RAM page. The page is
+ * written with one page write when it is full, so most calls cost no bus time.
+-*------------------------------------------------------------------*/
+void logger_add(unsigned char temp, unsigned char dtemp, unsigned char state)
+{
+    signed int delta = (signed int)temp - (signed int)log_prev;
+    unsigned char *rec;
+
+    /* A record holds no set temperature and only a signed byte change */
+    if(log_rec != 0 && (dtemp != log_page[LOG_DTEMP_BYTE] || delta > 127 || delta < -128))
+    {
+        logger_flush();
+    }
+    if(log_rec == 0)
+    {
+        log_page[LOG_SEQ_BYTE] = log_seq;
+        log_page[LOG_TEMP_BYTE] = temp;
+        log_page[LOG_DTEMP_BYTE] = dtemp;
+        log_prev = temp;
+        delta = 0;
+    }
+
+    rec = &log_page[LOG_HDR_SIZE + (log_rec * LOG_REC_SIZE)];
+    rec[0] = (unsigned char)(signed char)delta;
+    rec[1] = (unsigned char)((state << LOG_STATE_SHIFT) | (log_events & LOG_EV_MSK));
+    log_events = 0;
+    log_prev = temp;
+    log_rec++;
+
+    if(log_rec >= LOG_RECS_PER_PAGE)
+    {
+        logger_flush();
+    }
+}
+
+/*------------------------------------------------------------------*
+ * logger_event(unsigned char ev)
+ * This function flags events to be saved with the next record.
+-*------------------------------------------------------------------*/
+void logger_event(unsigned char ev)
+{
+    log_events |= ev;
+}
+
+/*------------------------------------------------------------------*
+ * logger_flush()
+ * This function pads the unused records, adds the CRC and writes the RAM
+ * page to the next ring page.
+-*------------------------------------------------------------------*/
+void logger_flush(void)
+{
+    unsigned char i;
+
+    if(log_rec == 0)
+    {
+        return;
+    }
+    for(i = LOG_HDR_SIZE + (log_rec * LOG_REC_SIZE) ; i < LOG_CRC_BYTE ; i++)
+    {
+        log_page[i] = LOG_REC_EMPTY;
+    }
+    log_page[LOG_CRC_BYTE] = crc8(log_page, LOG_CRC_BYTE);
+    storage_write_block(LOG_PAGE_ADDRESS(log_next), log_page, LOG_PAGE_SIZE);
+
+    log_next++;
+    if(log_next >= LOG_PAGES)
+    {
+        log_next = 0;
+    }
+    log_seq++;
+    log_rec = 0;
+}
+/*** End of File **************************************************************/
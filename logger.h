@@ -0,0 +1,114 @@
+/****************************************************************************
+* Title                 :   Temperature Logger
+* Filename              :   logger.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Region and interval can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   logger.h
+ *  \brief  This file contains the temperature history logger kept in a ring
+ *          of pages in the non volatile storage.
+ *
+ *  Page layout (one storage page, written with a single page write):
+ *      byte 0          page sequence number, used to find the ring head at boot
+ *      byte 1          temperature of the first record in the page
+ *      byte 2          set temperature for all the records in the page
+ *      byte 3..14      LOG_RECS_PER_PAGE records of 2 bytes
+ *                          byte 0  signed temperature change from the previous record
+ *                          byte 1  actuator state (bits 7-6) | event flags (bits 5-0)
+ *      byte 15         CRC8 of bytes 0..14
+ *  Unused records of a page flushed early are filled with LOG_REC_EMPTY.
+ *  A new page is started whenever the set temperature changes or the
+ *  temperature change does not fit in the record.
+ */
+
+#ifndef __LOGGER_H__
+#define __LOGGER_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "storage.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define LOG_PAGE_SIZE                       STORAGE_PAGE_SIZE
+#define LOG_HDR_SIZE                        3
+#define LOG_REC_SIZE                        2
+#define LOG_RECS_PER_PAGE                   ((LOG_PAGE_SIZE - LOG_HDR_SIZE - 1) / LOG_REC_SIZE)
+#define LOG_PAGE_ADDRESS(page)              (LOG_START_ADDRESS + ((unsigned int)(page) * LOG_PAGE_SIZE))
+
+#define LOG_SEQ_BYTE                        0
+#define LOG_TEMP_BYTE                       1
+#define LOG_DTEMP_BYTE                      2
+#define LOG_CRC_BYTE                        (LOG_PAGE_SIZE - 1)
+
+#define LOG_REC_EMPTY                       0xFF
+
+/* Actuator state (record byte 1 bits 7-6) */
+#define LOG_STATE_IDLE                      0
+#define LOG_STATE_HEATER                    1
+#define LOG_STATE_COOLER                    2
+#define LOG_STATE_SHIFT                     6
+
+/* Event flags (record byte 1 bits 5-0), accumulated since the previous record */
+#define LOG_EV_POWER_ON                     0x01
+#define LOG_EV_POWER_OFF                    0x02
+#define LOG_EV_SETPOINT                     0x04
+#define LOG_EV_WDT_RESET                    0x08
+#define LOG_EV_CALIBRATION                  0x10
+#define LOG_EV_POWER_FAIL                   0x20
+#define LOG_EV_MSK                          0x3F
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * logger_init()
+ *
+ * @brief This function finds the newest page of the ring so logging continues
+ *        after it.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void logger_init(void);
+
+/**
+ * logger_add()
+ *
+ * @brief This function appends a record to the RAM page, the page is written
+ *        to the storage only when it is full.
+ *
+ * @param <unsigned char temp> the averaged temperature
+ * @param <unsigned char dtemp> the set temperature
+ * @param <unsigned char state> LOG_STATE_IDLE, LOG_STATE_HEATER or LOG_STATE_COOLER
+ * @return <void>
+ */
+void logger_add(unsigned char temp, unsigned char dtemp, unsigned char state);
+
+/**
+ * logger_event()
+ *
+ * @brief This function flags events to be saved with the next record.
+ *
+ * @param <unsigned char ev> LOG_EV_xxx flags
+ * @return <void>
+ */
+void logger_event(unsigned char ev);
+
+/**
+ * logger_flush()
+ *
+ * @brief This function writes the RAM page to the storage even if it is not full.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void logger_flush(void);
+
+#endif
+/*** End of File **************************************************************/
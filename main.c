@@ -10,6 +10,7 @@
 *******************************************************************************/
 #include "EW_Heater.h"
 #include "sch.h"
+#include "bench.h"
 #include "xc.h"
 
 /******************************************************************************
@@ -26,6 +27,10 @@ void main()
 {
     MC_init();                      // Initializing MCU peripherals
     tasks_creation();               // Creating Electric Water Heater scheduler tasks
+    pwr_hooks_creation();           // Registering the power off / on sequence
+#if BENCH_ENABLE
+    bench_run();                    // Measuring the routines that are not probed
+#endif
     pwr_off();                      // Power off MCU at start
     while(1)
     {
@@ -0,0 +1,258 @@
+/****************************************************************************
+* Title                 :   Modbus RTU Slave
+* Filename              :   modbus.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Address, register count and frame gap can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   modbus.c
+ *  \brief  This file contains the Modbus RTU slave.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <xc.h>
+#include "config_EW_Heater.h"
+#include "modbus.h"
+#include "usart.h"
+#include "tstamp.h"
+#include "crc.h"
+#include "int.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define MB_T35_TICKS                        (MODBUS_T35_US / TSTAMP_US_PER_TICK)
+#define MB_FRAME_MAX                        (9 + 2 * MODBUS_MAX_REGS)   // write multiple request
+#define MB_FRAME_MIN                        4                           // address, function, CRC
+#define MB_FRAME_BAD                        0xFF
+#define MB_BROADCAST                        0
+
+#define MB_FC_READ_HOLDING                  0x03
+#define MB_FC_READ_INPUT                    0x04
+#define MB_FC_WRITE_SINGLE                  0x06
+#define MB_FC_WRITE_MULTIPLE                0x10
+
+#define MB_WORD(p)                          (((unsigned int)(p)[0] << 8) | (p)[1])
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * (mb_rx_cnt) bytes of the request being received, written by the ISR.
+ * (mb_frame_len) bytes of the closed request waiting in the USART RX ring,
+ * set by the ISR and cleared by modbus_process(). MB_FRAME_BAD marks a
+ * request that was closed while the previous one was not handled yet.
+-*------------------------------------------------------------------*/
+static volatile unsigned char mb_rx_cnt = 0;
+static volatile unsigned char mb_frame_len = 0;
+static unsigned char mb_buf[MB_FRAME_MAX];      // request, then reply
+static unsigned char mb_addr = MODBUS_ADDRESS;
+static MB_READ_T mb_read = 0;
+static MB_WRITE_T mb_write = 0;
+static unsigned int mb_bad_frames = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * modbus_init()
+ * CCP1 compare mode with a software interrupt only, the pin and Timer 1
+ * are not touched so the time base keeps running free.
+-*------------------------------------------------------------------*/
+void modbus_init(unsigned char addr, MB_READ_T rd, MB_WRITE_T wr)
+{
+    mb_addr = addr;
+    mb_read = rd;
+    mb_write = wr;
+    mb_rx_cnt = 0;
+    mb_frame_len = 0;
+    CCP1IE = 0;
+    CCP1CON = 0x0A;
+    CCP1IF = 0;
+}
+
+/*------------------------------------------------------------------*
+ * mb_rx_isr()
+ * The compare register is moved 3.5 characters after every byte, the
+ * interrupt fires only once the line stays silent.
+-*------------------------------------------------------------------*/
+void mb_rx_isr(void)
+{
+    uint16_t t35;
+
+    if(mb_rx_cnt < MB_FRAME_BAD)
+    {
+        mb_rx_cnt++;
+    }
+    CCP1IE = 0;
+    t35 = tstamp_get() + MB_T35_TICKS;
+    CCPR1H = (unsigned char)(t35 >> 8);
+    CCPR1L = (unsigned char)t35;
+    CCP1IF = 0;
+    CCP1IE = 1;
+}
+
+/*------------------------------------------------------------------*
+ * mb_t35_isr()
+ * A request closed before the previous one was handled is marked bad,
+ * the event for the previous one is still pending so no new one is needed.
+-*------------------------------------------------------------------*/
+unsigned char mb_t35_isr(void)
+{
+    unsigned char post = (mb_frame_len == 0);
+
+    CCP1IF = 0;
+    CCP1IE = 0;
+    mb_frame_len = post ? mb_rx_cnt : MB_FRAME_BAD;
+    mb_rx_cnt = 0;
+    return post;
+}
+
+/*------------------------------------------------------------------*
+ * mb_reply()
+ * Appends the CRC (low byte first) and queues the reply, a reply that
+ * does not fit the TX ring is dropped and the master times out.
+-*------------------------------------------------------------------*/
+static void mb_reply(unsigned char len)
+{
+    unsigned int crc = crc16(mb_buf, len);
+
+    mb_buf[len] = (unsigned char)crc;
+    mb_buf[len + 1] = (unsigned char)(crc >> 8);
+    usart_write(mb_buf, len + 2);
+}
+
+/*------------------------------------------------------------------*
+ * mb_execute()
+ * Runs the request in mb_buf and builds the reply in place.
+ * Returns the reply length without CRC, or an exception code with bit 7
+ * set (the reply then is address, function | 0x80, code).
+-*------------------------------------------------------------------*/
+static unsigned char mb_execute(unsigned char len)
+{
+    unsigned int reg = MB_WORD(&mb_buf[2]);
+    unsigned int qty = MB_WORD(&mb_buf[4]);
+    unsigned int val;
+    unsigned char i, ex;
+
+    switch(mb_buf[1])
+    {
+        case MB_FC_READ_HOLDING:
+        case MB_FC_READ_INPUT:
+            if(len != 8 || qty == 0 || qty > MODBUS_MAX_REGS)
+            {
+                return 0x80 | MB_EX_ILLEGAL_VALUE;
+            }
+            mb_buf[2] = (unsigned char)(qty * 2);
+            for(i = 0 ; i < qty ; i++)
+            {
+                ex = mb_read((mb_buf[1] == MB_FC_READ_INPUT) ? MB_TABLE_INPUT : MB_TABLE_HOLDING, reg + i, &val);
+                if(ex != MB_OK)
+                {
+                    return 0x80 | ex;
+                }
+                mb_buf[3 + 2 * i] = (unsigned char)(val >> 8);
+                mb_buf[4 + 2 * i] = (unsigned char)val;
+            }
+            return 3 + mb_buf[2];
+
+        case MB_FC_WRITE_SINGLE:
+            if(len != 8)
+            {
+                return 0x80 | MB_EX_ILLEGAL_VALUE;
+            }
+            ex = mb_write(reg, qty);
+            return (ex != MB_OK) ? (0x80 | ex) : 6;     // echo of the request
+
+        case MB_FC_WRITE_MULTIPLE:
+            if(qty == 0 || qty > MODBUS_MAX_REGS || mb_buf[6] != qty * 2 || len != 9 + mb_buf[6])
+            {
+                return 0x80 | MB_EX_ILLEGAL_VALUE;
+            }
+            for(i = 0 ; i < qty ; i++)
+            {
+                ex = mb_write(reg + i, MB_WORD(&mb_buf[7 + 2 * i]));
+                if(ex != MB_OK)
+                {
+                    return 0x80 | ex;
+                }
+            }
+            return 6;                                   // address, function, start, quantity
+
+        default:
+            return 0x80 | MB_EX_ILLEGAL_FUNCTION;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * modbus_process()
+ * Takes exactly the bytes of the closed request out of the RX ring, so
+ * a following request already arriving is left for the next event.
+ * Requests for another slave are dropped silently, broadcasts are run
+ * without a reply.
+-*------------------------------------------------------------------*/
+void modbus_process(void)
+{
+    unsigned char len, i, ret;
+    unsigned char c;
+
+    Disable_Global_INT();
+    len = mb_frame_len;
+    mb_frame_len = 0;
+    Enable_Global_INT();
+
+    if(len == MB_FRAME_BAD || len < MB_FRAME_MIN || len > MB_FRAME_MAX)
+    {
+        while(usart_getc(&c));          // resynchronise on the next request
+        if(mb_bad_frames < 0xFFFF)
+        {
+            mb_bad_frames++;
+        }
+        return;
+    }
+    for(i = 0 ; i < len ; i++)
+    {
+        if(!usart_getc(&mb_buf[i]))
+        {
+            break;                      // bytes lost on a full RX ring
+        }
+    }
+    if(i != len || crc16(mb_buf, len - 2) != (mb_buf[len - 2] | ((unsigned int)mb_buf[len - 1] << 8)))
+    {
+        if(mb_bad_frames < 0xFFFF)
+        {
+            mb_bad_frames++;
+        }
+        return;
+    }
+    if(mb_buf[0] != mb_addr && mb_buf[0] != MB_BROADCAST)
+    {
+        return;
+    }
+    ret = mb_execute(len);
+    if(mb_buf[0] == MB_BROADCAST)
+    {
+        return;
+    }
+    if(ret & 0x80)
+    {
+        mb_buf[1] |= 0x80;
+        mb_buf[2] = ret & 0x7F;
+        ret = 3;
+    }
+    mb_reply(ret);
+}
+
+/*------------------------------------------------------------------*
+ * modbus_get_bad_frames()
+ * This function gets the number of requests dropped.
+-*------------------------------------------------------------------*/
+unsigned int modbus_get_bad_frames(void)
+{
+    return mb_bad_frames;
+}
+/*** End of File **************************************************************/
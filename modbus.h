@@ -0,0 +1,112 @@
+/****************************************************************************
+* Title                 :   Modbus RTU Slave
+* Filename              :   modbus.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Address, register count and frame gap can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   modbus.h
+ *  \brief  This file contains the Modbus RTU slave running over the USART.
+ *
+ *  The end of a request is the 3.5 character silence measured from the last
+ *  received byte by the CCP1 compare on the Timer 1 time base. The request
+ *  is then handled by the dispatcher (modbus_process() as an event handler),
+ *  the reply is queued on the USART and sent by the TX interrupt.
+ *
+ *  Functions: 0x03 read holding, 0x04 read input, 0x06 write single and
+ *  0x10 write multiple registers, up to MODBUS_MAX_REGS registers each.
+ *  The registers themselves are served by the application callbacks.
+ */
+
+#ifndef __MODBUS_H__
+#define __MODBUS_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define MB_OK                               0
+
+/*------------------------------------------------------------------*
+ * Register tables passed to the read callback
+-*------------------------------------------------------------------*/
+#define MB_TABLE_HOLDING                    0
+#define MB_TABLE_INPUT                      1
+
+/*------------------------------------------------------------------*
+ * Exception codes returned by the callbacks (MB_OK = no exception)
+-*------------------------------------------------------------------*/
+#define MB_EX_ILLEGAL_FUNCTION              0x01
+#define MB_EX_ILLEGAL_ADDRESS               0x02
+#define MB_EX_ILLEGAL_VALUE                 0x03
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef unsigned char (*MB_READ_T)(unsigned char table, unsigned int reg, unsigned int *val);
+typedef unsigned char (*MB_WRITE_T)(unsigned int reg, unsigned int val);
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * modbus_init()
+ *
+ * @brief This function sets the slave address and the register callbacks
+ *        and sets CCP1 as the frame gap timer. The USART and Timer 1
+ *        (tstamp_init()) must be initialized.
+ *
+ * @param <unsigned char addr> the slave address, 1 - 247
+ * @param <MB_READ_T rd> reads one register of a table
+ * @param <MB_WRITE_T wr> writes one holding register
+ * @return <void>
+ */
+void modbus_init(unsigned char addr, MB_READ_T rd, MB_WRITE_T wr);
+
+/**
+ * mb_rx_isr()
+ *
+ * @brief This function is called by the RCIF interrupt after the byte is
+ *        stored, it counts the byte and restarts the 3.5 character timer.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void mb_rx_isr(void);
+
+/**
+ * mb_t35_isr()
+ *
+ * @brief This function is called by the CCP1 interrupt when the line was
+ *        silent for 3.5 characters, it closes the request.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> 1 if modbus_process() has to be scheduled
+ */
+unsigned char mb_t35_isr(void);
+
+/**
+ * modbus_process()
+ *
+ * @brief This function handles the last request and queues the reply, it
+ *        never waits for the line.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void modbus_process(void);
+
+/**
+ * modbus_get_bad_frames()
+ *
+ * @brief This function gets the number of requests dropped on a CRC, size
+ *        or overrun error (saturates at 0xFFFF).
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int>
+ */
+unsigned int modbus_get_bad_frames(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -95,6 +95,28 @@
 #define SW7_MSK       0x80
 #define PULLUP        nRBPU
 
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  USART (RC6 TX / RC7 RX, both set as inputs, the USART drives TX)
+ *
+ *****************************************************************************/
+#define USART_IO_REG        TRISC
+#define USART_PINS_MSK      0xC0
+/*****************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Debug pins (scope timing markers)
+ *
+ *****************************************************************************/
+#define DEBUG_IO_REG        TRISE
+#define DEBUG_PORT          PORTE
+#define DEBUG_ISR_MSK       0x01
+#define DEBUG_PWR_FAIL_MSK  0x02
+#define DEBUG_PWR_MSK       0x04
+#define DEBUG_ALL_MSK       0x07
 /*****************************************************************************/
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
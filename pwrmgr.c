@@ -0,0 +1,98 @@
+/****************************************************************************
+* Title                 :   Power Manager
+* Filename              :   pwrmgr.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   The number of hooks can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   pwrmgr.c
+ *  \brief  This file contains the power manager suspend / resume sequences.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "pwrmgr.h"
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef struct{
+    PWRMGR_HOOK_T suspend;
+    PWRMGR_HOOK_T resume;
+    unsigned char order;
+}PWRMGR_ENTRY_T;
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * The table is kept sorted by order at registration so the sequences
+ * are plain loops, the power button path does no sorting.
+-*------------------------------------------------------------------*/
+static PWRMGR_ENTRY_T pwrmgr_hooks[PWRMGR_MAX_HOOKS];
+static unsigned char pwrmgr_cnt = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * pwrmgr_register()
+ * This function inserts the hooks after the last entry with the same
+ * or a lower order.
+-*------------------------------------------------------------------*/
+unsigned char pwrmgr_register(PWRMGR_HOOK_T suspend, PWRMGR_HOOK_T resume, unsigned char order)
+{
+    unsigned char i;
+
+    if(pwrmgr_cnt >= PWRMGR_MAX_HOOKS)
+    {
+        return PWRMGR_ERROR;
+    }
+    for(i = pwrmgr_cnt ; i > 0 && pwrmgr_hooks[i - 1].order > order ; i--)
+    {
+        pwrmgr_hooks[i] = pwrmgr_hooks[i - 1];
+    }
+    pwrmgr_hooks[i].suspend = suspend;
+    pwrmgr_hooks[i].resume = resume;
+    pwrmgr_hooks[i].order = order;
+    pwrmgr_cnt++;
+    return PWRMGR_OK;
+}
+
+/*------------------------------------------------------------------*
+ * pwrmgr_suspend()
+ * This function runs the suspend hooks from the lowest order.
+-*------------------------------------------------------------------*/
+void pwrmgr_suspend(void)
+{
+    unsigned char i;
+
+    for(i = 0 ; i < pwrmgr_cnt ; i++)
+    {
+        if(pwrmgr_hooks[i].suspend)
+        {
+            pwrmgr_hooks[i].suspend();
+        }
+    }
+}
+
+/*------------------------------------------------------------------*
+ * pwrmgr_resume()
+ * This function runs the resume hooks from the highest order.
+-*------------------------------------------------------------------*/
+void pwrmgr_resume(void)
+{
+    unsigned char i;
+
+    for(i = pwrmgr_cnt ; i > 0 ; i--)
+    {
+        if(pwrmgr_hooks[i - 1].resume)
+        {
+            pwrmgr_hooks[i - 1].resume();
+        }
+    }
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,75 @@
+/****************************************************************************
+* Title                 :   Power Manager
+* Filename              :   pwrmgr.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   The number of hooks can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   pwrmgr.h
+ *  \brief  This file contains the power manager. Every module that must be
+ *          stopped before the sleep and restarted after the wake up registers
+ *          a suspend and a resume hook with an order:
+ *              - the suspend hooks run from the lowest to the highest order.
+ *              - the resume hooks run from the highest to the lowest order,
+ *                so a module resumes after everything it depends on.
+ */
+
+#ifndef __PWRMGR_H__
+#define __PWRMGR_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define PWRMGR_OK                           0
+#define PWRMGR_ERROR                        1
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef void (* PWRMGR_HOOK_T)(void);
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * pwrmgr_register()
+ *
+ * @brief This function registers the suspend and resume hooks of a module,
+ *        modules with the same order run in their registration order.
+ *
+ * @param <PWRMGR_HOOK_T suspend> called before the sleep (may be 0)
+ * @param <PWRMGR_HOOK_T resume> called after the wake up (may be 0)
+ * @param <unsigned char order> the position of the module in the sequence
+ * @return <unsigned char> PWRMGR_OK or PWRMGR_ERROR if the table is full
+ */
+unsigned char pwrmgr_register(PWRMGR_HOOK_T suspend, PWRMGR_HOOK_T resume, unsigned char order);
+
+/**
+ * pwrmgr_suspend()
+ *
+ * @brief This function runs the suspend hooks from the lowest order.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void pwrmgr_suspend(void);
+
+/**
+ * pwrmgr_resume()
+ *
+ * @brief This function runs the resume hooks from the highest order.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void pwrmgr_resume(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,124 @@
+/****************************************************************************
+* Title                 :   Input Recorder
+* Filename              :   record.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by SERIAL_PROTOCOL_RECORD in config_EW_Heater.h
+*******************************************************************************/
+/** \file   record.c
+ *  \brief  This file contains the recorder of the external inputs.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "record.h"
+
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_RECORD
+#include <xc.h>
+#include "usart.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * (rec_now) ticks counted by the ISR, (rec_last) tick of the last record.
+ * (rec_port) last recorded switch port, the replay starts from 0 too.
+ * (rec_lost) records dropped since the last LOST record.
+-*------------------------------------------------------------------*/
+static volatile unsigned int rec_now = 0;
+static unsigned int rec_last = 0;
+static unsigned char rec_port = 0;
+static unsigned char rec_lost = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * rec_put()
+ * Queues one record, the caller holds the interrupts off.
+-*------------------------------------------------------------------*/
+static unsigned char rec_put(unsigned char kind, unsigned char ch, unsigned char delta, unsigned int val)
+{
+    unsigned char rec[REC_SIZE];
+
+    rec[0] = REC_SYNC | (kind << 4) | (ch & 0x0F);
+    rec[1] = delta;
+    rec[2] = (unsigned char)(val >> 7) & 0x7F;
+    rec[3] = (unsigned char)val & 0x7F;
+    return usart_write(rec, REC_SIZE);
+}
+
+/*------------------------------------------------------------------*
+ * rec_tick()
+ * This function counts a scheduler tick.
+-*------------------------------------------------------------------*/
+void rec_tick(void)
+{
+    rec_now++;
+}
+
+/*------------------------------------------------------------------*
+ * rec_input()
+ * Long gaps are split with SKIP records. A record that does not fit the
+ * TX ring is counted and reported by a LOST record once there is room,
+ * the replay stops being exact from there.
+ * The interrupts are held off so a record from the ISR can not interleave
+ * with one from a task, the previous GIE state is restored.
+-*------------------------------------------------------------------*/
+void rec_input(unsigned char kind, unsigned char ch, unsigned int val)
+{
+    unsigned char gie = GIE;
+    unsigned int delta;
+
+    GIE = 0;
+    if(rec_lost)
+    {
+        if(rec_put(REC_KIND_LOST, 0, 0, rec_lost) == USART_OK)
+        {
+            rec_lost = 0;
+        }
+    }
+    delta = rec_now - rec_last;
+    while(rec_lost == 0 && delta > REC_MAX_DELTA)
+    {
+        if(rec_put(REC_KIND_SKIP, 0, REC_MAX_DELTA, 0) != USART_OK)
+        {
+            break;
+        }
+        delta -= REC_MAX_DELTA;
+        rec_last += REC_MAX_DELTA;
+    }
+    if(rec_lost || delta > REC_MAX_DELTA || rec_put(kind, ch, (unsigned char)delta, val) != USART_OK)
+    {
+        if(rec_lost < 0xFF)
+        {
+            rec_lost++;
+        }
+    }
+    else
+    {
+        rec_last = rec_now;
+    }
+    if(gie)
+    {
+        GIE = 1;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * rec_portb()
+ * The switch port is sampled every tick, only the changes are recorded.
+-*------------------------------------------------------------------*/
+void rec_portb(unsigned char val)
+{
+    if(val != rec_port)
+    {
+        rec_port = val;
+        rec_input(REC_KIND_PORTB, 0, val);
+    }
+}
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,101 @@
+/****************************************************************************
+* Title                 :   Input Recorder
+* Filename              :   record.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by SERIAL_PROTOCOL_RECORD in config_EW_Heater.h
+*******************************************************************************/
+/** \file   record.h
+ *  \brief  This file contains the recorder of the external inputs (ADC
+ *          results, switch port samples and power switch wake ups) with
+ *          their scheduler tick. The records are streamed over the USART
+ *          and replayed on the host by tools/replay.c.
+ *
+ *  Record (4 bytes, only the first one has bit 7 set so a reader can sync):
+ *      [0] 0x80 | kind << 4 | channel
+ *      [1] ticks since the previous record, 0 - REC_MAX_DELTA
+ *      [2] value >> 7
+ *      [3] value & 0x7F
+ *  The tick only counts while the scheduler runs (Timer 0 stops in sleep).
+ */
+
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define REC_SIZE                            4
+#define REC_SYNC                            0x80
+#define REC_MAX_DELTA                       0x7F
+
+/*------------------------------------------------------------------*
+ * Record kinds
+-*------------------------------------------------------------------*/
+#define REC_KIND_SKIP                       0       // no input, only moves the tick
+#define REC_KIND_ADC                        1       // channel, result of adc_get()
+#define REC_KIND_PORTB                      2       // raw switch port, on change only
+#define REC_KIND_INT                        3       // wake up edge of the power switch
+#define REC_KIND_LOST                       4       // records dropped on a full TX ring
+
+/*------------------------------------------------------------------*
+ * Record points, compiled out unless the inputs are recorded
+-*------------------------------------------------------------------*/
+#if SERIAL_PROTOCOL == SERIAL_PROTOCOL_RECORD
+#define REC_TICK()                          rec_tick()
+#define REC_ADC(ch, val)                    rec_input(REC_KIND_ADC, (ch), (val))
+#define REC_PORTB(val)                      rec_portb(val)
+#define REC_INT()                           rec_input(REC_KIND_INT, 0, 0)
+#else
+#define REC_TICK()
+#define REC_ADC(ch, val)
+#define REC_PORTB(val)
+#define REC_INT()
+#endif
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * rec_tick()
+ *
+ * @brief This function counts a scheduler tick, it is called first by the
+ *        Timer 0 ISR. Use the REC_TICK() macro so the call compiles out.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void rec_tick(void);
+
+/**
+ * rec_input()
+ *
+ * @brief This function records an input, it can be called from the ISR and
+ *        from the tasks.
+ *
+ * @param <unsigned char kind> the REC_KIND_xxx of the input
+ * @param <unsigned char ch> the channel, 0 - 15
+ * @param <unsigned int val> the value, 0 - 0x3FFF
+ * @return <void>
+ */
+void rec_input(unsigned char kind, unsigned char ch, unsigned int val);
+
+/**
+ * rec_portb()
+ *
+ * @brief This function records a switch port sample if it changed.
+ *
+ * @param <unsigned char val> the raw port
+ * @return <void>
+ */
+void rec_portb(unsigned char val);
+
+#endif
+/*** End of File **************************************************************/
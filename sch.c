@@ -13,8 +13,12 @@
 /******************************************************************************
 * Includes
 *******************************************************************************/
+#include <xc.h>
 #include "pic16f877a.h"
 #include "sch.h"
+#include "trace.h"
+#include "bench.h"
+#include "tstamp.h"
 #include <stdio.h>
 #include <stdint.h>
 
@@ -24,6 +28,52 @@
 static sTask SCH_tasks_G[SCH_MAX_TASKS];
 static unsigned char Error_code_G = 0;
 
+/*------------------------------------------------------------------*
+ * Stall attribution: SCH_running_G holds what the dispatcher is running,
+ * it is kept in persistent RAM (not cleared by the start up code) so
+ * after a watchdog reset it still names the task that stopped the kicks.
+-*------------------------------------------------------------------*/
+#define SCH_RUNNING_NONE                    SCH_STALL_OUTSIDE
+static __persistent unsigned char SCH_running_G;
+static __persistent unsigned char SCH_wdt_resets_G;
+static unsigned char SCH_stalled_G = SCH_NO_STALL;
+
+/*------------------------------------------------------------------*
+ * Event queue: single producer (the ISRs) / single consumer (the
+ * dispatcher). The ISR only writes SCH_ev_head and the dispatcher only
+ * writes SCH_ev_tail, both are single bytes so no locking is needed.
+ * An event is written before the head is moved past it.
+-*------------------------------------------------------------------*/
+#define SCH_EVENT_MSK                       (SCH_EVENT_QUEUE_SIZE - 1)
+static void (* SCH_handlers_G[SCH_MAX_EVENTS])(void);
+static volatile unsigned char SCH_ev_buf[SCH_EVENT_QUEUE_SIZE];
+static volatile unsigned char SCH_ev_head = 0;
+static volatile unsigned char SCH_ev_tail = 0;
+
+#if SCH_LOAD_ENABLE
+/*------------------------------------------------------------------*
+ * Load meter, times in TSTAMP_US_PER_TICK units. SCH_isr_time_G is the
+ * running (wrapping) ISR time, written by the ISR only. SCH_load_ticks is
+ * counted by SCH_Update() and SCH_load_mark only by the dispatcher, like
+ * RunMe / Done. The sums of the window are kept by the dispatcher and the
+ * load is published at the end of every window, the percentage is a
+ * multiply and shift (SCH_LOAD_SCALE / 2^18 = 100 / window time).
+-*------------------------------------------------------------------*/
+#define SCH_LOAD_TIME                       ((unsigned long)SCH_LOAD_WINDOW * SCH_TICK * 1000 / TSTAMP_US_PER_TICK)
+#define SCH_LOAD_SCALE                      (((100UL << 18) + SCH_LOAD_TIME / 2) / SCH_LOAD_TIME)
+static volatile uint16_t SCH_isr_time_G = 0;
+static uint16_t SCH_isr_t0;
+static volatile unsigned char SCH_load_ticks = 0;
+static unsigned char SCH_load_mark = 0;
+static uint16_t SCH_isr_last = 0;
+static unsigned long SCH_task_sum = 0;
+static unsigned long SCH_isr_sum = 0;
+static unsigned int SCH_peak_run = 0;
+static unsigned int SCH_load_acc = 0;       // 4 x rolling load
+static unsigned char SCH_isr_load_G = 0;
+static unsigned int SCH_peak_G = 0;
+#endif
+
 /******************************************************************************
 * Functions
 *******************************************************************************/
@@ -32,15 +82,46 @@ static unsigned char Error_code_G = 0;
 sch_init()
 Initializes the scheduler tick time with 5ms uses Timer 0 starts counting from
 100 and overflows at 256
+The reset cause is read first: a watchdog time out while running clears
+nTO and leaves nPD set (a watchdog wake up from sleep clears both).
 -*------------------------------------------------------------------*/
 void sch_init(void)
 {
     unsigned int i;
+    if (nPOR == 0) 
+    { 
+        // Power on reset: the persistent RAM holds garbage 
+        nPOR = 1;
+        SCH_wdt_resets_G = 0;
+    }
+    else if (nTO == 0 && nPD == 1) 
+    { 
+        SCH_stalled_G = SCH_running_G;
+        if (SCH_wdt_resets_G < 0xFF) 
+        { 
+            SCH_wdt_resets_G++; 
+        }
+    }
+    SCH_running_G = SCH_RUNNING_NONE;
+    CLRWDT();                   // Sets nTO / nPD again
     for (i = 0; i < SCH_MAX_TASKS; i++) 
     {   
         SCH_Delete_Task(i); 
     }
+    for (i = 0; i < SCH_MAX_EVENTS; i++) 
+    {   
+        SCH_handlers_G[i] = 0; 
+    }
+    SCH_ev_head = 0;
+    SCH_ev_tail = 0;
     Error_code_G = 0;
+#if SCH_LOAD_ENABLE
+    SCH_load_mark = SCH_load_ticks;
+    SCH_isr_last = SCH_isr_time_G;
+    SCH_task_sum = 0;
+    SCH_isr_sum = 0;
+    SCH_peak_run = 0;
+#endif
     /* Timer 0 initialization */
     /* Set the prescaler with a division 64 for 5ms Tick configurations */
     PS0 = 1;                    
@@ -95,26 +176,387 @@ unsigned char SCH_Add_Task(void (* pFunction)(void), const unsigned int DELAY, c
     SCH_tasks_G[Index].Delay  = DELAY; 
     SCH_tasks_G[Index].Period = PERIOD;
     SCH_tasks_G[Index].RunMe  = 0;
+    SCH_tasks_G[Index].Done   = 0;
+    SCH_tasks_G[Index].Overruns = 0;
+    SCH_tasks_G[Index].Policy = SCH_CATCH_UP;
+    SCH_tasks_G[Index].Late   = 0;
+    SCH_tasks_G[Index].Deadline = SCH_DEADLINE_DEFAULT;
+    SCH_tasks_G[Index].MaxTime = 0;
     
     return Index; // return position of task (to allow later deletion) 
 }
 
+/*------------------------------------------------------------------*
+SCH_Update()
+This is the scheduler tick called by the Timer 0 interrupt. Every due task
+ages its heartbeat until the dispatcher runs it, the watchdog is kicked
+only while no heartbeat is older than its deadline. A task stuck in a loop
+(or a starved one) stops the kicks and the watchdog resets the MCU.
+-*------------------------------------------------------------------*/
+void SCH_Update(void) 
+{ 
+    unsigned char Index;
+    unsigned char Fresh = 1;
+#if SCH_LOAD_ENABLE
+    SCH_load_ticks++;
+#endif
+    for (Index = 0; Index < SCH_MAX_TASKS ; Index++) 
+    {
+        // Check if there is a task at this location 
+        if (SCH_tasks_G[Index].pTask) 
+        { 
+            if (SCH_tasks_G[Index].Delay == 0) 
+            { 
+                // Due again while the last run is still pending 
+                if (SCH_tasks_G[Index].RunMe != SCH_tasks_G[Index].Done && SCH_tasks_G[Index].Overruns < 0xFF) 
+                { 
+                    SCH_tasks_G[Index].Overruns += 1; 
+                }
+                // The task is due to run 
+                SCH_tasks_G[Index].RunMe += 1; // Inc. the 'RunMe' flag
+                if (SCH_tasks_G[Index].Period) 
+                { 
+                    // Schedule periodic tasks to run again 
+                    SCH_tasks_G[Index].Delay = SCH_tasks_G[Index].Period; 
+                } 
+            } 
+            else 
+            { 
+                // Not yet ready to run: just decrement the delay 
+                SCH_tasks_G[Index].Delay -= 1; 
+            } 
+            // Heartbeat: age of a due task 
+            if (SCH_tasks_G[Index].RunMe != SCH_tasks_G[Index].Done) 
+            { 
+                if (SCH_tasks_G[Index].Late < 0xFF) 
+                { 
+                    SCH_tasks_G[Index].Late += 1; 
+                }
+                if (SCH_tasks_G[Index].Late > SCH_tasks_G[Index].Deadline) 
+                { 
+                    Fresh = 0; 
+                }
+            }
+        } 
+    }
+    if (Fresh) 
+    { 
+        CLRWDT(); 
+    }
+}
+
+/*------------------------------------------------------------------*
+SCH_Set_Deadline()
+Sets the heartbeat deadline of a task
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Set_Deadline(const unsigned char TASK_INDEX, const unsigned char TICKS) 
+{ 
+    if (TASK_INDEX >= SCH_MAX_TASKS || SCH_tasks_G[TASK_INDEX].pTask == 0) 
+    { 
+        return RETURN_ERROR; 
+    }
+    SCH_tasks_G[TASK_INDEX].Deadline = TICKS;
+    return RETURN_NORMAL;
+}
+
+/*------------------------------------------------------------------*
+SCH_Set_Policy()
+Sets the overrun policy of a task
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Set_Policy(const unsigned char TASK_INDEX, const unsigned char POLICY) 
+{ 
+    if (TASK_INDEX >= SCH_MAX_TASKS || SCH_tasks_G[TASK_INDEX].pTask == 0 || POLICY > SCH_COUNT) 
+    { 
+        return RETURN_ERROR; 
+    }
+    SCH_tasks_G[TASK_INDEX].Policy = POLICY;
+    return RETURN_NORMAL;
+}
+
+/*------------------------------------------------------------------*
+SCH_Set_Period()
+Changes the period of a task, the 16 bit Period and Delay are also used by
+SCH_Update() so they are changed with the interrupts disabled
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Set_Period(const unsigned char TASK_INDEX, const unsigned int PERIOD) 
+{ 
+    unsigned char Gie;
+    if (TASK_INDEX >= SCH_MAX_TASKS || SCH_tasks_G[TASK_INDEX].pTask == 0 || PERIOD == 0) 
+    { 
+        return RETURN_ERROR; 
+    }
+    Gie = GIE;
+    GIE = 0;
+    SCH_tasks_G[TASK_INDEX].Period = PERIOD;
+    if (SCH_tasks_G[TASK_INDEX].Delay > PERIOD) 
+    { 
+        SCH_tasks_G[TASK_INDEX].Delay = PERIOD; 
+    }
+    GIE = Gie;
+    return RETURN_NORMAL;
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_Overruns()
+Gets the number of ticks a task was due while still pending
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Get_Overruns(const unsigned char TASK_INDEX) 
+{ 
+    if (TASK_INDEX >= SCH_MAX_TASKS) 
+    { 
+        return 0; 
+    }
+    return SCH_tasks_G[TASK_INDEX].Overruns;
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_Error()
+Gets the last scheduler error
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Get_Error(void) 
+{ 
+    return Error_code_G;
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_Stalled()
+Gets what was running when the watchdog reset the MCU
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Get_Stalled(void) 
+{ 
+    return SCH_stalled_G;
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_WDT_Resets()
+Gets the number of watchdog resets since the power up
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Get_WDT_Resets(void) 
+{ 
+    return SCH_wdt_resets_G;
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_Load() / SCH_Get_ISR_Load() / SCH_Get_Peak_Busy()
+Get the load meter results of the last windows
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Get_Load(void) 
+{ 
+#if SCH_LOAD_ENABLE
+    return (unsigned char)((SCH_load_acc + 2) >> 2);
+#else
+    return 0;
+#endif
+}
+
+unsigned char SCH_Get_ISR_Load(void) 
+{ 
+#if SCH_LOAD_ENABLE
+    return SCH_isr_load_G;
+#else
+    return 0;
+#endif
+}
+
+unsigned int SCH_Get_Peak_Busy(void) 
+{ 
+#if SCH_LOAD_ENABLE
+    return SCH_peak_G;
+#else
+    return 0;
+#endif
+}
+
+/*------------------------------------------------------------------*
+SCH_Get_Max_Time()
+Gets the longest run of a task
+-*------------------------------------------------------------------*/ 
+unsigned int SCH_Get_Max_Time(const unsigned char TASK_INDEX) 
+{ 
+    if (TASK_INDEX >= SCH_MAX_TASKS) 
+    { 
+        return 0; 
+    }
+    return SCH_tasks_G[TASK_INDEX].MaxTime;
+}
+
+#if SCH_LOAD_ENABLE
+/*------------------------------------------------------------------*
+SCH_ISR_Enter() / SCH_ISR_Exit()
+Time one interrupt service, the PIC16 does not nest interrupts
+-*------------------------------------------------------------------*/ 
+void SCH_ISR_Enter(void) 
+{ 
+    SCH_isr_t0 = tstamp_get();
+}
+
+void SCH_ISR_Exit(void) 
+{ 
+    SCH_isr_time_G += tstamp_get() - SCH_isr_t0;
+}
+
+/*------------------------------------------------------------------*
+sch_isr_time()
+Reads the running ISR time, read again if an interrupt changed it meanwhile
+-*------------------------------------------------------------------*/ 
+static uint16_t sch_isr_time(void) 
+{ 
+    uint16_t Time;
+    do 
+    { 
+        Time = SCH_isr_time_G;
+    } while (Time != SCH_isr_time_G);
+    return Time;
+}
+
+/*------------------------------------------------------------------*
+sch_load_account()
+Accounts one dispatcher pass started at START with the ISR time ISR_START.
+The pass is read before the ISR time at its start and after it at its end
+so the ISR time inside the pass never exceeds the pass. The ISR time
+between two passes is counted as well, only busy passes count as task
+time. At the end of a window the load is published: the window load is
+added to the rolling load (4 windows) and the peak of the window is kept.
+-*------------------------------------------------------------------*/ 
+static void sch_load_account(const uint16_t START, const uint16_t ISR_START, const unsigned char BUSY) 
+{ 
+    uint16_t Isr = sch_isr_time();
+    uint16_t Time = tstamp_get() - START;
+    unsigned char Load;
+    
+    SCH_isr_sum += (uint16_t)(Isr - SCH_isr_last);
+    SCH_isr_last = Isr;
+    if (BUSY) 
+    { 
+        Isr -= ISR_START;       // ISR time inside the pass
+        if (Time > Isr) 
+        { 
+            SCH_task_sum += Time - Isr; 
+        }
+        if (Time > SCH_peak_run) 
+        { 
+            SCH_peak_run = Time; 
+        }
+    }
+    if ((unsigned char)(SCH_load_ticks - SCH_load_mark) >= SCH_LOAD_WINDOW) 
+    { 
+        SCH_load_mark += SCH_LOAD_WINDOW;
+        Load = (unsigned char)(((SCH_task_sum + SCH_isr_sum) * SCH_LOAD_SCALE) >> 18);
+        SCH_load_acc = SCH_load_acc - (SCH_load_acc >> 2) + ((Load > 100) ? 100 : Load);
+        SCH_isr_load_G = (unsigned char)((SCH_isr_sum * SCH_LOAD_SCALE) >> 18);
+        SCH_peak_G = SCH_peak_run;
+        SCH_task_sum = 0;
+        SCH_isr_sum = 0;
+        SCH_peak_run = 0;
+    }
+}
+#endif
+
+/*------------------------------------------------------------------*
+SCH_Add_Event_Handler()
+Registers the function run by the dispatcher for every posted EVENT
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Add_Event_Handler(const unsigned char EVENT, void (* pFunction)(void)) 
+{ 
+    if (EVENT >= SCH_MAX_EVENTS) 
+    { 
+        return RETURN_ERROR; 
+    }
+    SCH_handlers_G[EVENT] = pFunction;
+    return RETURN_NORMAL;
+}
+
+/*------------------------------------------------------------------*
+SCH_Post_Event()
+Queues an event for the dispatcher, called from the ISRs only.
+A full queue drops the event and sets the global error variable.
+-*------------------------------------------------------------------*/ 
+unsigned char SCH_Post_Event(const unsigned char EVENT) 
+{ 
+    unsigned char Next = (SCH_ev_head + 1) & SCH_EVENT_MSK;
+    
+    if (Next == SCH_ev_tail) 
+    { 
+        Error_code_G = ERROR_SCH_EVENT_QUEUE_FULL;
+        return RETURN_ERROR; 
+    }
+    SCH_ev_buf[SCH_ev_head] = EVENT;
+    SCH_ev_head = Next;         // publish the event
+    return RETURN_NORMAL;
+}
+
 /*------------------------------------------------------------------*
 SCH_Dispatch_Tasks()
 This is the 'dispatcher' function. When a task (function) is due to run,
 SCH_Dispatch_Tasks() will run it. This function must be called (repeatedly)
 from the main loop.
+The posted events are handled first, in the order they were posted.
+RunMe is only written by the ISR and Done only by the dispatcher so the
+pending count (RunMe - Done) is read without disabling the interrupts, a
+tick arriving meanwhile is simply seen on the next pass.
+Every pass is timed for the load meter, a pass that ran nothing is idle.
 -*------------------------------------------------------------------*/ 
 void SCH_Dispatch_Tasks(void) 
 { 
     unsigned char Index;
+    unsigned char Due;
+#if SCH_LOAD_ENABLE
+    uint16_t Start = tstamp_get();
+    uint16_t Isr_Start = sch_isr_time();
+    unsigned char Busy = 0;
+    uint16_t Run;
+#endif
+    BENCH_BEGIN(BENCH_DISPATCH);
+    // Runs the handlers of the queued events 
+    while (SCH_ev_tail != SCH_ev_head) 
+    { 
+        Index = SCH_ev_buf[SCH_ev_tail];
+        SCH_ev_tail = (SCH_ev_tail + 1) & SCH_EVENT_MSK;
+        if (Index < SCH_MAX_EVENTS && SCH_handlers_G[Index]) 
+        { 
+            SCH_running_G = SCH_MAX_TASKS + Index;
+#if SCH_LOAD_ENABLE
+            Busy = 1;
+#endif
+            TRACE(TRACE_EVENT_BEGIN, Index);
+            (SCH_handlers_G[Index])(); 
+            TRACE(TRACE_EVENT_END, Index);
+            SCH_running_G = SCH_RUNNING_NONE;
+        }
+    }
     // Dispatches (runs) the next task (if one is ready) 
     for (Index = 0; Index < SCH_MAX_TASKS; Index++) 
     { 
-        if (SCH_tasks_G[Index].RunMe > 0) 
+        Due = SCH_tasks_G[Index].RunMe;   // Single read of the ISR counter
+        if (Due != SCH_tasks_G[Index].Done) 
         { 
+            // More than one run pending: drop the missed ones unless catching up 
+            if ((unsigned char)(Due - SCH_tasks_G[Index].Done) > 1 && SCH_tasks_G[Index].Policy != SCH_CATCH_UP) 
+            { 
+                SCH_tasks_G[Index].Done = Due - 1;
+                if (SCH_tasks_G[Index].Policy == SCH_COUNT) 
+                { 
+                    Error_code_G = ERROR_SCH_TASK_OVERRUN; 
+                }
+            }
+            SCH_running_G = Index;
+#if SCH_LOAD_ENABLE
+            Busy = 1;
+            Run = tstamp_get();
+#endif
+            TRACE(TRACE_TASK_BEGIN, Index);
             (SCH_tasks_G[Index].pTask)(); // Run the task
-            SCH_tasks_G[Index].RunMe -= 1; // Reset / reduce RunMe flag
+            TRACE(TRACE_TASK_END, Index);
+#if SCH_LOAD_ENABLE
+            Run = tstamp_get() - Run;
+            if (Run > SCH_tasks_G[Index].MaxTime) 
+            { 
+                SCH_tasks_G[Index].MaxTime = Run; 
+            }
+#endif
+            SCH_running_G = SCH_RUNNING_NONE;
+            SCH_tasks_G[Index].Late = 0;   // Heartbeat
+            SCH_tasks_G[Index].Done += 1;  // Reset / reduce the pending runs
             // Periodic tasks will automatically run again // - if this is a 'one shot' task, remove it from the array 
             if (SCH_tasks_G[Index].Period == 0) 
             { 
@@ -122,6 +564,10 @@ void SCH_Dispatch_Tasks(void)
             } 
         }
     }
+    BENCH_END(BENCH_DISPATCH);
+#if SCH_LOAD_ENABLE
+    sch_load_account(Start, Isr_Start, Busy);
+#endif
 // The scheduler enters idle mode at this point 
     SCH_Go_To_Sleep(); 
 }
@@ -149,15 +595,18 @@ unsigned char SCH_Delete_Task(const unsigned char TASK_INDEX)
     SCH_tasks_G[TASK_INDEX].Delay = 0; 
     SCH_tasks_G[TASK_INDEX].Period = 0;
     SCH_tasks_G[TASK_INDEX].RunMe = 0;
+    SCH_tasks_G[TASK_INDEX].Done = 0;
+    SCH_tasks_G[TASK_INDEX].Late = 0;
 return Return_code; // return status 
 }
 
 /*------------------------------------------------------------------*
 SCH_Go_To_Sleep(const unsigned char TASK_INDEX)
- * Enters idle mode
+ * Idle point of the dispatcher. The PIC16 has no idle mode: SLEEP stops
+ * the oscillator and Timer 0 (no more ticks) and the watchdog would wake
+ * it, so the dispatcher returns and polls again.
 -*------------------------------------------------------------------*/ 
 void SCH_Go_To_Sleep(void) 
 { 
-    asm("SLEEP");    // Enter idle mode
 }
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -22,7 +22,36 @@
 /**
  * Define the system maximum number of tasks
  */
-#define SCH_MAX_TASKS                       5
+#define SCH_MAX_TASKS                       6
+
+/**
+ * Define the number of event handlers and the event queue length
+ * (the queue length must be a power of 2, it holds one event less)
+ */
+#define SCH_MAX_EVENTS                      3
+#define SCH_EVENT_QUEUE_SIZE                8
+
+/**
+ * Define the default heartbeat deadline: the ticks a due task may wait for
+ * the dispatcher before the watchdog is no longer kicked
+ */
+#define SCH_DEADLINE_DEFAULT                20
+
+/**
+ * Define the load meter: the time of the dispatcher passes that ran a task
+ * or an event handler and the time of the interrupts are summed over a
+ * window of SCH_LOAD_WINDOW ticks (1s), the rest of the window is idle
+ * (SCH_Go_To_Sleep() polling). 0 removes the meter and its overhead.
+ */
+#define SCH_LOAD_ENABLE                     1
+#define SCH_LOAD_WINDOW                     200
+
+/**
+ * Values of SCH_Get_Stalled(): no watchdog reset / watchdog reset while no
+ * task was running, otherwise the task index or SCH_MAX_TASKS + event number
+ */
+#define SCH_NO_STALL                        0xFF
+#define SCH_STALL_OUTSIDE                   0xFE
 
 /******************************************************************************
 * Typedefs
@@ -39,8 +68,20 @@ typedef struct {
     unsigned int Delay; 
     // Interval (ticks) between subsequent runs. // - see SCH_Add_Task() for further details 
     unsigned int Period; 
-    // Incremented (by scheduler) when task is due to execute 
+    // Incremented (by scheduler ISR only) when task is due to execute 
     unsigned char RunMe; 
+    // Incremented (by dispatcher only) for every handled RunMe, RunMe - Done runs are pending 
+    unsigned char Done; 
+    // Ticks the task was due again while still pending - see SCH_Get_Overruns() 
+    unsigned char Overruns; 
+    // What the dispatcher does with the pending runs - see SCH_Set_Policy() 
+    unsigned char Policy; 
+    // Ticks the task has been due without running (heartbeat age) 
+    unsigned char Late; 
+    // Heartbeat deadline (ticks) - see SCH_Set_Deadline() 
+    unsigned char Deadline; 
+    // Longest run (TSTAMP_US_PER_TICK units) - see SCH_Get_Max_Time() 
+    unsigned int MaxTime; 
 } sTask;
 
 /**
@@ -49,8 +90,23 @@ typedef struct {
  */
 typedef enum 
 {
-    RETURN_ERROR,RETURN_NORMAL,ERROR_SCH_CANNOT_DELETE_TASK,ERROR_SCH_TOO_MANY_TASKS
+    RETURN_ERROR,RETURN_NORMAL,ERROR_SCH_CANNOT_DELETE_TASK,ERROR_SCH_TOO_MANY_TASKS,
+    ERROR_SCH_EVENT_QUEUE_FULL,ERROR_SCH_TASK_OVERRUN
 }SCH_E;
+
+/**
+ * Enum SCH_POLICY_E
+ * SCH_POLICY_E enumeration type is used to define what the dispatcher does
+ * when a task was due more than once before it could run
+ *      - SCH_CATCH_UP   runs the task once per pending tick (default)
+ *      - SCH_SKIP       runs the task once, the missed ticks are dropped
+ *      - SCH_COUNT      as SCH_SKIP and reports ERROR_SCH_TASK_OVERRUN
+ * The missed ticks are counted by SCH_Get_Overruns() for every policy.
+ */
+typedef enum 
+{
+    SCH_CATCH_UP,SCH_SKIP,SCH_COUNT
+}SCH_POLICY_E;
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
@@ -108,6 +164,172 @@ void SCH_Dispatch_Tasks(void);
  */
 unsigned char SCH_Add_Task(void (* pFunction)(void), const unsigned int DELAY, const unsigned int PERIOD);
 
+/**
+ * SCH_Update()
+ * 
+ * @brief This is the scheduler tick called by the Timer 0 interrupt. It marks
+ *        the due tasks and kicks the watchdog only while every due task ran
+ *        within its heartbeat deadline.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void SCH_Update(void);
+
+/**
+ * SCH_Set_Deadline()
+ * 
+ * @brief Sets the heartbeat deadline of a task (SCH_DEADLINE_DEFAULT when
+ *        the task is added)
+ *
+ * @param <TASK_INDEX> the index returned by SCH_Add_Task()
+ * @param <TICKS> the ticks the task may be due without running
+ * @return <unsigned char> RETURN_NORMAL or RETURN_ERROR
+ */
+unsigned char SCH_Set_Deadline(const unsigned char TASK_INDEX, const unsigned char TICKS);
+
+/**
+ * SCH_Set_Policy()
+ * 
+ * @brief Sets the overrun policy of a task (SCH_CATCH_UP when the task is added)
+ *
+ * @param <TASK_INDEX> the index returned by SCH_Add_Task()
+ * @param <POLICY> SCH_CATCH_UP, SCH_SKIP or SCH_COUNT
+ * @return <unsigned char> RETURN_NORMAL or RETURN_ERROR
+ */
+unsigned char SCH_Set_Policy(const unsigned char TASK_INDEX, const unsigned char POLICY);
+
+/**
+ * SCH_Set_Period()
+ * 
+ * @brief Changes the period of a periodic task at run time, a pending delay
+ *        longer than the new period is cut to it so a faster rate starts at once
+ *
+ * @param <TASK_INDEX> the index returned by SCH_Add_Task()
+ * @param <PERIOD> the new period in ticks (not 0, a task is not made one shot)
+ * @return <unsigned char> RETURN_NORMAL or RETURN_ERROR
+ */
+unsigned char SCH_Set_Period(const unsigned char TASK_INDEX, const unsigned int PERIOD);
+
+/**
+ * SCH_Get_Overruns()
+ * 
+ * @brief Gets the number of ticks a task was due while still pending
+ *
+ * @param <TASK_INDEX> the task index
+ * @return <unsigned char> the count (saturates at 255)
+ */
+unsigned char SCH_Get_Overruns(const unsigned char TASK_INDEX);
+
+/**
+ * SCH_Get_Error()
+ * 
+ * @brief Gets the last scheduler error
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> 0 or an SCH_E error
+ */
+unsigned char SCH_Get_Error(void);
+
+/**
+ * SCH_Get_Stalled()
+ * 
+ * @brief Gets what was running when the watchdog reset the MCU
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> SCH_NO_STALL, SCH_STALL_OUTSIDE, the task index or
+ *         SCH_MAX_TASKS + the event number of a handler
+ */
+unsigned char SCH_Get_Stalled(void);
+
+/**
+ * SCH_Get_WDT_Resets()
+ * 
+ * @brief Gets the number of watchdog resets since the power up
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char>
+ */
+unsigned char SCH_Get_WDT_Resets(void);
+
+/**
+ * SCH_Get_Load()
+ * 
+ * @brief Gets the CPU load (tasks and interrupts) averaged over the last
+ *        windows, the idle time is the rest to 100%
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> the load in percent
+ */
+unsigned char SCH_Get_Load(void);
+
+/**
+ * SCH_Get_ISR_Load()
+ * 
+ * @brief Gets the part of the last window spent in the interrupts
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> the load in percent
+ */
+unsigned char SCH_Get_ISR_Load(void);
+
+/**
+ * SCH_Get_Peak_Busy()
+ * 
+ * @brief Gets the longest dispatcher pass (tasks and the interrupts taken
+ *        meanwhile) of the last window, the busy time of the worst tick
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int> time in TSTAMP_US_PER_TICK units
+ */
+unsigned int SCH_Get_Peak_Busy(void);
+
+/**
+ * SCH_Get_Max_Time()
+ * 
+ * @brief Gets the longest run of a task since it was added, interrupts
+ *        taken meanwhile included (0 without the load meter)
+ *
+ * @param <TASK_INDEX> the task index returned by SCH_Add_Task()
+ * @return <unsigned int> time in TSTAMP_US_PER_TICK units
+ */
+unsigned int SCH_Get_Max_Time(const unsigned char TASK_INDEX);
+
+/**
+ * SCH_ISR_Enter() / SCH_ISR_Exit()
+ * 
+ * @brief Time the interrupt service for the load meter, called first and
+ *        last by the ISR
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void SCH_ISR_Enter(void);
+void SCH_ISR_Exit(void);
+
+/**
+ * SCH_Add_Event_Handler()
+ * 
+ * @brief Registers the function run by the dispatcher for every posted EVENT,
+ *        event handlers do not use the periodic task slots
+ *
+ * @param <EVENT> the event number (0 .. SCH_MAX_EVENTS - 1)
+ * @param <pFunction> the handler (must be a 'void (void)' function)
+ * @return <unsigned char> RETURN_NORMAL or RETURN_ERROR
+ */
+unsigned char SCH_Add_Event_Handler(const unsigned char EVENT, void (* pFunction)(void));
+
+/**
+ * SCH_Post_Event()
+ * 
+ * @brief Queues an event for the dispatcher, called from the ISRs only
+ *        (the queue has a single producer)
+ *
+ * @param <EVENT> the event number
+ * @return <unsigned char> RETURN_NORMAL or RETURN_ERROR if the queue is full
+ */
+unsigned char SCH_Post_Event(const unsigned char EVENT);
+
 /**
  * SCH_Delete_Task()
  * 
@@ -121,7 +343,7 @@ unsigned char SCH_Delete_Task(const unsigned char TASK_INDEX);
 /**
  * SCH_Go_To_Sleep()
  * 
- * @brief Disables all enabled SSDs and Clears the data port "d"
+ * @brief Idle point of the dispatcher
  *
  * @param <void> takes no arguments
  * @return <void>
@@ -0,0 +1,167 @@
+/****************************************************************************
+* Title                 :   Settings Store
+* Filename              :   settings.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Region and defaults can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   settings.c
+ *  \brief  This file contains the persistent settings store kept in the
+ *          non volatile storage.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "crc.h"
+#include "settings.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * static SETTINGS_RECORD_T (settings) is the RAM copy of the newest record
+ * static unsigned char (settings_slot) is the slot the newest record is saved in
+ * static unsigned char (settings_dirty) is set when a value changed since the last commit
+-*------------------------------------------------------------------*/
+static SETTINGS_RECORD_T settings;
+static unsigned char settings_slot = SETTINGS_SLOTS - 1;
+static unsigned char settings_dirty = 0;
+
+/* the record is saved as one page write, this fails to build if it does not fill the page */
+typedef char settings_record_size_check[(sizeof(SETTINGS_RECORD_T) == STORAGE_PAGE_SIZE) ? 1 : -1];
+
+static const unsigned int settings_defaults[SETTINGS_KEYS_NUM] = {
+    INITIAL_TEMP,                   // SET_KEY_DTEMP
+    TEMP_ERROR_VAL,                 // SET_KEY_HEAT_HYST
+    TEMP_ERROR_VAL,                 // SET_KEY_COOL_HYST
+    TEMP_CAL_GAIN_DEFAULT,          // SET_KEY_CAL_GAIN
+    TEMP_CAL_OFFSET_DEFAULT,        // SET_KEY_CAL_OFFSET
+    0,                              // SET_KEY_ENERGY_LO
+    0                               // SET_KEY_ENERGY_HI
+};
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * settings_put(SETTINGS_KEY_T key, unsigned int val)
+ * This function stores a value in the RAM copy, low byte first.
+-*------------------------------------------------------------------*/
+static void settings_put(SETTINGS_KEY_T key, unsigned int val)
+{
+    settings.val[key][0] = (uint8_t)val;
+    settings.val[key][1] = (uint8_t)(val >> 8);
+}
+
+/*------------------------------------------------------------------*
+ * settings_init()
+ * This function reads every slot of the settings region once and keeps the
+ * valid record with the newest sequence number. The sequence numbers of the
+ * valid records are at most SETTINGS_SLOTS apart so the wrap around is
+ * handled by a signed difference.
+ * If no valid record is found (new or erased memory) the defaults are loaded
+ * and the set temperature saved at TEMP_SAVE_ADDRESS by older firmware is kept.
+-*------------------------------------------------------------------*/
+unsigned char settings_init(void)
+{
+    SETTINGS_RECORD_T rec;
+    unsigned char slot;
+    unsigned char found = 0;
+    unsigned char legacy;
+
+    for(slot = 0 ; slot < SETTINGS_SLOTS ; slot++)
+    {
+        if(storage_read_block(SETTINGS_SLOT_ADDRESS(slot), (unsigned char *)&rec, SETTINGS_RECORD_SIZE) != STORAGE_OK)
+        {
+            break;      // storage not answering, keep what is found so far
+        }
+        if(crc8((unsigned char *)&rec, SETTINGS_RECORD_SIZE - 1) != rec.crc)
+        {
+            continue;   // blank or torn record
+        }
+        if(found == 0 || (signed char)(rec.seq - settings.seq) > 0)
+        {
+            settings = rec;
+            settings_slot = slot;
+            found = 1;
+        }
+    }
+
+    if(found)
+    {
+        settings_dirty = 0;
+        return SETTINGS_LOADED;
+    }
+
+    for(slot = 0 ; slot < SETTINGS_KEYS_NUM ; slot++)
+    {
+        settings_put((SETTINGS_KEY_T)slot, settings_defaults[slot]);
+    }
+    settings.seq = 0;
+    settings_slot = SETTINGS_SLOTS - 1;
+
+    legacy = storage_r(TEMP_SAVE_ADDRESS);
+    if(legacy >= MIN_SET_TEMP && legacy <= MAX_SET_TEMP)
+    {
+        settings_put(SET_KEY_DTEMP, legacy);
+    }
+    settings_dirty = 1;
+    return SETTINGS_DEFAULTS;
+}
+
+/*------------------------------------------------------------------*
+ * settings_get(SETTINGS_KEY_T key)
+ * This function gets the value of a setting from the RAM copy.
+-*------------------------------------------------------------------*/
+unsigned int settings_get(SETTINGS_KEY_T key)
+{
+    return settings.val[key][0] | ((unsigned int)settings.val[key][1] << 8);
+}
+
+/*------------------------------------------------------------------*
+ * settings_set(SETTINGS_KEY_T key, unsigned int val)
+ * This function changes a setting in the RAM copy and marks it for saving.
+-*------------------------------------------------------------------*/
+void settings_set(SETTINGS_KEY_T key, unsigned int val)
+{
+    if(settings_get(key) != val)
+    {
+        settings_put(key, val);
+        settings_dirty = 1;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * settings_commit()
+ * This function writes the RAM copy to the slot after the newest one as a
+ * single page write. The old record stays valid until the new one is
+ * completely written, a power loss during the write loses only the change.
+-*------------------------------------------------------------------*/
+unsigned char settings_commit(void)
+{
+    unsigned char ret;
+
+    if(settings_dirty == 0)
+    {
+        return STORAGE_OK;
+    }
+
+    settings.seq++;
+    settings.crc = crc8((unsigned char *)&settings, SETTINGS_RECORD_SIZE - 1);
+    settings_slot++;
+    if(settings_slot >= SETTINGS_SLOTS)
+    {
+        settings_slot = 0;
+    }
+
+    ret = storage_write_block(SETTINGS_SLOT_ADDRESS(settings_slot), (unsigned char *)&settings, SETTINGS_RECORD_SIZE);
+    if(ret == STORAGE_OK)
+    {
+        settings_dirty = 0;
+    }
+    return ret;
+}
+/*** End of File **************************************************************/
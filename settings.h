@@ -0,0 +1,120 @@
+/****************************************************************************
+* Title                 :   Settings Store
+* Filename              :   settings.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Region and defaults can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   settings.h
+ *  \brief  This file contains the persistent settings store kept in the
+ *          non volatile storage.
+ *
+ *  The settings are saved as a log of complete records, one storage page each.
+ *  Every commit writes the next slot of the region with an incremented
+ *  sequence number and a CRC8, so the writes are spread over all the slots
+ *  and a torn or blank record is never loaded. At boot the newest valid
+ *  record is found by reading the SETTINGS_SLOTS slots once.
+ */
+
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdint.h>
+#include "config_EW_Heater.h"
+#include "storage.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define SETTINGS_RECORD_SIZE                STORAGE_PAGE_SIZE
+#define SETTINGS_SLOT_ADDRESS(slot)         (SETTINGS_START_ADDRESS + ((unsigned int)(slot) * SETTINGS_RECORD_SIZE))
+
+#define SETTINGS_LOADED                     0
+#define SETTINGS_DEFAULTS                   1
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+/*****************************************************************************
+ *
+ *  Settings keys
+ *  note: the record must fit in one storage page (1 + 2*SETTINGS_KEYS_NUM + 1 bytes)
+ *
+ *****************************************************************************/
+typedef enum{
+    SET_KEY_DTEMP       ,   // Set temperature
+    SET_KEY_HEAT_HYST   ,   // Heating hysteresis in degrees
+    SET_KEY_COOL_HYST   ,   // Cooling hysteresis in degrees
+    SET_KEY_CAL_GAIN    ,   // Temperature sensor calibration gain
+    SET_KEY_CAL_OFFSET  ,   // Temperature sensor calibration offset
+    SET_KEY_ENERGY_LO   ,   // Lifetime energy counter low word
+    SET_KEY_ENERGY_HI   ,   // Lifetime energy counter high word
+    SETTINGS_KEYS_NUM
+}SETTINGS_KEY_T;
+
+/**
+ * Struct SETTINGS_RECORD_T
+ * One record of the settings log as it is saved in the EEPROM. The values
+ * are kept as byte pairs, low byte first like an XC8 int, so the record
+ * has no padding and the same layout on the host tools.
+ */
+typedef struct{
+    uint8_t seq;                            // Incremented on every commit
+    uint8_t val[SETTINGS_KEYS_NUM][2];      // Settings values indexed by SETTINGS_KEY_T
+    uint8_t crc;                            // CRC8 of the bytes before it
+}SETTINGS_RECORD_T;
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * settings_init()
+ *
+ * @brief This function scans the settings region and loads the newest valid
+ *        record, if there is none the default values are loaded.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> SETTINGS_LOADED or SETTINGS_DEFAULTS
+ */
+unsigned char settings_init(void);
+
+/**
+ * settings_get()
+ *
+ * @brief This function gets the value of a setting.
+ *
+ * @param <SETTINGS_KEY_T key> the setting to read
+ * @return <unsigned int> the setting value
+ */
+unsigned int settings_get(SETTINGS_KEY_T key);
+
+/**
+ * settings_set()
+ *
+ * @brief This function changes the value of a setting in RAM, the change is
+ *        saved to the EEPROM by the next settings_commit().
+ *
+ * @param <SETTINGS_KEY_T key> the setting to change
+ * @param <unsigned int val> the new value
+ * @return <void>
+ */
+void settings_set(SETTINGS_KEY_T key, unsigned int val);
+
+/**
+ * settings_commit()
+ *
+ * @brief This function saves the settings to the next slot of the region
+ *        with one page write if any of them changed.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> STORAGE_OK or STORAGE_ERROR
+ */
+unsigned char settings_commit(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -15,22 +15,81 @@
 *******************************************************************************/
 #include "ssd.h"
 #include "port.h"
+#include "config_EW_Heater.h"
 /******************************************************************************
 * Constants
 *******************************************************************************/
 /* const char table[16] is an array of 16 elements for LED representation for every digit on the SSD in hexadecimal */
 static const char table[16]={0x3F,0x06,0x5B,0x4F,0x66,0x6D,0x7D,0x07,0x7F,0x6F,0x77,0x7C,0x58,0x5E,0x79,0x71};
 
+/* const unsigned char ssd_en_msk[4] is the enable mask of the board SSDs from right to left,
+ * digit 0 of the display is ssd_en_msk[SSD_RIGHT_DIGIT] */
+static const unsigned char ssd_en_msk[4]={SSD4_MSK,SSD3_MSK,SSD2_MSK,SSD1_MSK};
+
+#if SSD_RIGHT_DIGIT + SSD_NUM > 4
+#error "SSD_RIGHT_DIGIT + SSD_NUM is more than the 4 SSDs on the board"
+#endif
+#if TEMP_SENSOR_CH == 2 && (SSD_RIGHT_DIGIT + SSD_NUM > 3)
+#error "SSD1 enable is RA2 which is the temperature sensor input AN2"
+#endif
+
+/* SSD_MAX_VAL is the largest value shown on SSD_NUM digits */
+#if SSD_NUM == 1
+#define SSD_MAX_VAL     9
+#elif SSD_NUM == 2
+#define SSD_MAX_VAL     99
+#elif SSD_NUM == 3
+#define SSD_MAX_VAL     999
+#else
+#define SSD_MAX_VAL     9999
+#endif
+
+/* const unsigned int ssd_pow10[4] is the weight of every decimal digit, used to convert without dividing */
+static const unsigned int ssd_pow10[4]={1,10,100,1000};
+
+/* SSD_SLOT is the Timer 2 counts of one digit slot (1ms) */
+#define SSD_SLOT        (SSD_MUX_PR2 + 1)
+
+/* const unsigned char ssd_on_time[SSD_BRIGHT_LEVELS] is the on time of a digit in its slot for every brightness level */
+static const unsigned char ssd_on_time[SSD_BRIGHT_LEVELS]={SSD_SLOT/8,SSD_SLOT/4,SSD_SLOT/2,SSD_SLOT};
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * static unsigned char (ssd_fb) is the frame buffer, the segments byte of every digit
+ * static unsigned char (ssd_cur) is the digit strobed by the next Timer 2 interrupt
+-*------------------------------------------------------------------*/
+static unsigned char ssd_fb[SSD_NUM];
+static unsigned char ssd_cur = 0;
+
+/*------------------------------------------------------------------*
+ * Duty engine
+ * static unsigned char (ssd_on) is the on time of the digits in Timer 2 counts, 0 = dark
+ * static unsigned char (ssd_lit) is set while a digit is in its on time
+ * static unsigned char (ssd_bright) is the brightness level
+ * static unsigned char (ssd_blank_req) is set while the display is blanked
+ * static unsigned char (ssd_blink_en) is set while the display blinks
+ * static unsigned char (ssd_blink_cnt) counts the duty ticks of the blinking period
+-*------------------------------------------------------------------*/
+static unsigned char ssd_on = SSD_SLOT;
+static unsigned char ssd_lit = 0;
+static unsigned char ssd_bright = SSD_BRIGHTNESS;
+static unsigned char ssd_blank_req = 0;
+static unsigned char ssd_blink_en = 0;
+static unsigned char ssd_blink_cnt = 0;
+
 /******************************************************************************
 * Functions
 *******************************************************************************/
 /*------------------------------------------------------------------*
  * ssd_init(unsigned char SSD_MSK)
- * Initializes SSD_MSK of the SSD on the board
+ * Initializes SSD_MSK of the SSD on the board, enables outside
+ * SSD_USED_MSK are left alone (SSD1 shares RA2 with the sensor input)
 -*------------------------------------------------------------------*/ 
 void ssd_init(unsigned char SSD_MSK)
 {
-    TRISA &= ~SSD_MSK;          // initialize SSD enable pin as an output
+    TRISA &= ~(SSD_MSK & SSD_USED_MSK);          // initialize SSD enable pin as an output
     TRISD &= ~0xFF;             // initialize data port as output
     SSD_DATA_PORT &= ~0xFF;     // clear data port
     
@@ -51,17 +110,279 @@ void ssd_write_data(unsigned char value)
 -*------------------------------------------------------------------*/ 
 void ssd_en(unsigned char SSD_MSK)
 {
-    SSD_EN_PORT &= ~SSD_ALL_MSK;
-    SSD_EN_PORT |= SSD_MSK;
+    SSD_EN_PORT &= ~SSD_USED_MSK;
+    SSD_EN_PORT |= SSD_MSK & SSD_USED_MSK;
 }
 
 /*------------------------------------------------------------------*
  * ssd_off()
- * Disables all enabled SSDs and Clears the data port "d"
+ * Stops the multiplexing, disables all enabled SSDs and Clears the data port "d"
 -*------------------------------------------------------------------*/ 
 void ssd_off(void)
 {
-    SSD_EN_PORT &= ~SSD_ALL_MSK;
+    TMR2IE = 0;
+    TMR2ON = 0;
+    SSD_EN_PORT &= ~SSD_USED_MSK;
     SSD_DATA_PORT &= ~0xFF;
 }
+
+/*------------------------------------------------------------------*
+ * ssd_mux_init()
+ * Initializes Timer 2 for 1ms digit slots (prescaler 16, PR2 124 at 2MHz
+ * instruction clock) so every digit is refreshed at 1000/SSD_NUM Hz.
+-*------------------------------------------------------------------*/ 
+void ssd_mux_init(void)
+{
+    T2CON = 0x02;               // prescaler 16, postscaler 1, timer off
+    PR2 = SSD_MUX_PR2;
+    TMR2 = 0;
+    TMR2IF = 0;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_mux_start()
+ * Starts the multiplexing interrupt
+-*------------------------------------------------------------------*/ 
+void ssd_mux_start(void)
+{
+    ssd_lit = 0;
+    PR2 = SSD_MUX_PR2;
+    TMR2IF = 0;
+    TMR2ON = 1;
+    TMR2IE = 1;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_mux_isr()
+ * Called by the Timer 2 interrupt. A digit slot is split in an on time and
+ * a dark time by reloading PR2, so a dimmed display costs two interrupts
+ * per slot and a full brightness one costs a single interrupt:
+ *      - at the end of the on time the digit is turned off and PR2 is set
+ *        to the rest of the slot.
+ *      - at the start of a slot the next digit of the frame buffer is shown
+ *        and PR2 is set to the on time.
+ * The enables are turned off while the data port changes to avoid ghosting.
+-*------------------------------------------------------------------*/ 
+void ssd_mux_isr(void)
+{
+    SSD_EN_PORT &= ~SSD_USED_MSK;
+    if(ssd_lit)
+    {
+        ssd_lit = 0;
+        if(ssd_on < SSD_SLOT)
+        {
+            PR2 = (SSD_SLOT - 1) - ssd_on;  // dark for the rest of the slot
+            return;
+        }
+    }
+    ssd_cur++;
+    if(ssd_cur >= SSD_NUM)
+    {
+        ssd_cur = 0;
+    }
+    if(ssd_on == 0)
+    {
+        PR2 = SSD_SLOT - 1;                 // blanked, the whole slot is dark
+        return;
+    }
+    SSD_DATA_PORT = ssd_fb[ssd_cur];
+    SSD_EN_PORT |= ssd_en_msk[SSD_RIGHT_DIGIT + ssd_cur];
+    PR2 = ssd_on - 1;
+    ssd_lit = 1;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_duty_tick()
+ * Called every SSD_TASK_PERIOD ms. Advances the blinking period and sets the
+ * on time used by the multiplexing interrupt from the brightness level, the
+ * blinking phase and the blank request. The digits blink with a period of
+ * 2 * SSD_BLINK_PERIOD, on for the first half.
+-*------------------------------------------------------------------*/ 
+void ssd_duty_tick(void)
+{
+    if(ssd_blink_en)
+    {
+        ssd_blink_cnt++;
+        if(ssd_blink_cnt >= 2 * (SSD_BLINK_PERIOD/SSD_TASK_PERIOD))
+        {
+            ssd_blink_cnt = 0;
+        }
+    }
+    if(ssd_blank_req || ssd_blink_cnt >= (SSD_BLINK_PERIOD/SSD_TASK_PERIOD))
+    {
+        ssd_on = 0;
+    }
+    else
+    {
+        ssd_on = ssd_on_time[ssd_bright];
+    }
+}
+
+/*------------------------------------------------------------------*
+ * ssd_set_brightness()
+ * Sets the brightness level 0 - (SSD_BRIGHT_LEVELS - 1), applied by the next ssd_duty_tick()
+-*------------------------------------------------------------------*/ 
+void ssd_set_brightness(unsigned char level)
+{
+    if(level < SSD_BRIGHT_LEVELS)
+    {
+        ssd_bright = level;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * ssd_set_blink()
+ * Starts / stops blinking, blinking always starts with the digits on
+-*------------------------------------------------------------------*/ 
+void ssd_set_blink(unsigned char en)
+{
+    if(en != ssd_blink_en)
+    {
+        ssd_blink_en = en;
+        ssd_blink_cnt = 0;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * ssd_set_blank()
+ * Blanks / unblanks the display without touching the frame buffer
+-*------------------------------------------------------------------*/ 
+void ssd_set_blank(unsigned char en)
+{
+    ssd_blank_req = en;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_fb_write()
+ * Writes the segments byte of a digit to the frame buffer
+-*------------------------------------------------------------------*/ 
+void ssd_fb_write(unsigned char digit, unsigned char seg)
+{
+    ssd_fb[digit] = seg;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_fb_read()
+ * Reads the segments byte of a digit from the frame buffer
+-*------------------------------------------------------------------*/ 
+unsigned char ssd_fb_read(unsigned char digit)
+{
+    return ssd_fb[digit];
+}
+
+/*------------------------------------------------------------------*
+ * ssd_fb_digit()
+ * Writes the segments of a hexadecimal value to a digit of the frame buffer
+-*------------------------------------------------------------------*/ 
+void ssd_fb_digit(unsigned char digit, unsigned char value)
+{
+    ssd_fb[digit] = table[ value ];
+}
+
+/*------------------------------------------------------------------*
+ * ssd_bcd()
+ * Converts a binary value to SSD_NUM decimal digits (bcd[0] is the units)
+ * by subtracting the weight of every digit, at most 9 subtractions per
+ * digit and no call to the division routine.
+ * Returns 1 if the value does not fit in the display.
+-*------------------------------------------------------------------*/ 
+static unsigned char ssd_bcd(unsigned int val, unsigned char *bcd)
+{
+    unsigned char i , d;
+
+    if(val > SSD_MAX_VAL)
+    {
+        return 1;
+    }
+    for(i = SSD_NUM - 1 ; i > 0 ; i--)
+    {
+        d = 0;
+        while(val >= ssd_pow10[i])
+        {
+            val -= ssd_pow10[i];
+            d++;
+        }
+        bcd[i] = d;
+    }
+    bcd[0] = (unsigned char)val;
+    return 0;
+}
+
+/*------------------------------------------------------------------*
+ * ssd_show_number()
+ * Renders a decimal value right aligned in the frame buffer, leading zeros
+ * are blanked left of the decimal point digit (dp SSD_NO_DP for no point).
+ * A value in tenths of a degree is shown with dp = 1.
+ * Values that do not fit are shown as dashes.
+-*------------------------------------------------------------------*/ 
+void ssd_show_number(unsigned int val, unsigned char dp)
+{
+    unsigned char bcd[SSD_NUM];
+    unsigned char i , lead = 1;
+
+    if(ssd_bcd(val, bcd))
+    {
+        for(i = 0 ; i < SSD_NUM ; i++)
+        {
+            ssd_fb[i] = SSD_SEG_DASH;
+        }
+        return;
+    }
+    for(i = SSD_NUM - 1 ; i > 0 ; i--)
+    {
+        if(lead && bcd[i] == 0 && (dp == SSD_NO_DP || i > dp))
+        {
+            ssd_fb[i] = SSD_SEG_BLANK;
+        }
+        else
+        {
+            lead = 0;
+            ssd_fb[i] = table[ bcd[i] ];
+        }
+    }
+    ssd_fb[0] = table[ bcd[0] ];
+    if(dp < SSD_NUM)
+    {
+        ssd_fb[dp] |= SSD_SEG_DP;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * ssd_show_code()
+ * Renders a status / error code: the left digit shows a letter of the
+ * hexadecimal table (0xA - 0xF : A b C d E F) and the other digits the code number.
+-*------------------------------------------------------------------*/ 
+void ssd_show_code(unsigned char letter, unsigned char code)
+{
+    ssd_show_number(code, SSD_NO_DP);
+    ssd_fb[SSD_NUM - 1] = table[ letter & 0x0F ];
+}
+
+/*------------------------------------------------------------------*
+ * ssd_show_hex()
+ * Renders a byte with the hexadecimal table, the high nibble on the second
+ * digit from the right.
+-*------------------------------------------------------------------*/ 
+void ssd_show_hex(unsigned char val)
+{
+    ssd_blank();
+    ssd_fb[0] = table[ val & 0x0F ];
+#if SSD_NUM > 1
+    ssd_fb[1] = table[ val >> 4 ];
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * ssd_blank()
+ * Turns off all the segments of the frame buffer
+-*------------------------------------------------------------------*/ 
+void ssd_blank(void)
+{
+    unsigned char i;
+
+    for(i = 0 ; i < SSD_NUM ; i++)
+    {
+        ssd_fb[i] = SSD_SEG_BLANK;
+    }
+}
 /*** End of File **************************************************************/
@@ -15,6 +15,22 @@
 *******************************************************************************/
 #ifndef __SSD_H__
 #define __SSD_H__
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define SSD_NO_DP           0xFF    // no decimal point for ssd_show_number()
+#define SSD_SEG_BLANK       0x00
+#define SSD_SEG_DASH        0x40
+#define SSD_SEG_DP          0x80
+
+/* SSD_USED_MSK is the enables of the SSD_NUM board SSDs starting at SSD_RIGHT_DIGIT
+ * (SSD4 is the lowest bit, see port.h), only these pins are outputs and driven */
+#define SSD_USED_MSK        ((unsigned char)(((SSD4_MSK << 1) >> SSD_RIGHT_DIGIT) - \
+                                             ((SSD4_MSK << 1) >> (SSD_RIGHT_DIGIT + SSD_NUM))))
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
 /**
  * ssd_init()
  * 
@@ -55,5 +71,152 @@ void ssd_en(unsigned char SSD_MSK);
  */
 void ssd_off(void);
 
+/**
+ * ssd_mux_init()
+ * 
+ * @brief Initializes Timer 2 used to multiplex the digits
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void ssd_mux_init(void);
+
+/**
+ * ssd_mux_start()
+ * 
+ * @brief Starts the multiplexing interrupt, ssd_off() stops it
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void ssd_mux_start(void);
+
+/**
+ * ssd_mux_isr()
+ * 
+ * @brief Shows the next digit of the frame buffer, called by the Timer 2 interrupt
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void ssd_mux_isr(void);
+
+/**
+ * ssd_duty_tick()
+ * 
+ * @brief Advances the blinking period and updates the digits on time,
+ *        must be called every SSD_TASK_PERIOD ms
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void ssd_duty_tick(void);
+
+/**
+ * ssd_set_brightness()
+ * 
+ * @brief Sets the display brightness as the on time of every digit in its slot
+ *
+ * @param <level> the brightness level 0 (dimmest) - SSD_BRIGHT_LEVELS-1 (full)
+ * @return <void>
+ */
+void ssd_set_brightness(unsigned char level);
+
+/**
+ * ssd_set_blink()
+ * 
+ * @brief Starts / stops blinking the display
+ *
+ * @param <en> 1 to blink, 0 to stop
+ * @return <void>
+ */
+void ssd_set_blink(unsigned char en);
+
+/**
+ * ssd_set_blank()
+ * 
+ * @brief Blanks / unblanks the display without changing the frame buffer
+ *
+ * @param <en> 1 to blank, 0 to show the frame buffer
+ * @return <void>
+ */
+void ssd_set_blank(unsigned char en);
+
+/**
+ * ssd_fb_write()
+ * 
+ * @brief Writes the segments byte of a digit to the frame buffer
+ *
+ * @param <digit> the digit index, 0 is the right digit
+ * @param <seg> the segments byte (bit 0 = segment a)
+ * @return <void>
+ */
+void ssd_fb_write(unsigned char digit, unsigned char seg);
+
+/**
+ * ssd_fb_read()
+ * 
+ * @brief Reads the segments byte of a digit from the frame buffer
+ *
+ * @param <digit> the digit index, 0 is the right digit
+ * @return <unsigned char> the segments byte (bit 0 = segment a)
+ */
+unsigned char ssd_fb_read(unsigned char digit);
+
+/**
+ * ssd_fb_digit()
+ * 
+ * @brief Writes the segments of a hexadecimal value to a digit of the frame buffer
+ *
+ * @param <digit> the digit index, 0 is the right digit
+ * @param <value> the value 0 - 15
+ * @return <void>
+ */
+void ssd_fb_digit(unsigned char digit, unsigned char value);
+
+/**
+ * ssd_show_number()
+ * 
+ * @brief Renders a decimal value (0 - 9999 depending on SSD_NUM) right aligned
+ *        in the frame buffer without dividing, leading zeros are blanked.
+ *
+ * @param <val> the value to display, in tenths when dp is 1
+ * @param <dp> the digit showing the decimal point or SSD_NO_DP
+ * @return <void>
+ */
+void ssd_show_number(unsigned int val, unsigned char dp);
+
+/**
+ * ssd_show_code()
+ * 
+ * @brief Renders a status / error code, a letter on the left digit and a number
+ *
+ * @param <letter> hexadecimal table index of the letter (0xA - 0xF)
+ * @param <code> the code number shown on the other digits
+ * @return <void>
+ */
+void ssd_show_code(unsigned char letter, unsigned char code);
+
+/**
+ * ssd_show_hex()
+ * 
+ * @brief Renders a byte as two hexadecimal digits on the right, the other
+ *        digits are blank (one digit displays show the low nibble)
+ *
+ * @param <val> the byte to display
+ * @return <void>
+ */
+void ssd_show_hex(unsigned char val);
+
+/**
+ * ssd_blank()
+ * 
+ * @brief Turns off all the segments of the frame buffer
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void ssd_blank(void);
+
 #endif
 /*** End of File **************************************************************/
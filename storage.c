@@ -0,0 +1,215 @@
+/****************************************************************************
+* Title                 :   Storage
+* Filename              :   storage.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   The backend is selected by STORAGE_BACKEND in config_EW_Heater.h
+*******************************************************************************/
+/** \file   storage.c
+ *  \brief  This file contains the non volatile storage backends:
+ *          - STORAGE_BACKEND_E2PEXT  external 24C04 on the bit banged I2C bus
+ *          - STORAGE_BACKEND_INT     PIC internal data EEPROM, no bus traffic
+ *          - STORAGE_BACKEND_FILE    file backed mock for host builds
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "storage.h"
+
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+#include "eeprom_ext.h"
+#elif STORAGE_BACKEND == STORAGE_BACKEND_INT
+#include <xc.h>
+#elif STORAGE_BACKEND == STORAGE_BACKEND_FILE
+#include <stdio.h>
+#else
+#error "STORAGE_BACKEND is not set to a known backend"
+#endif
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define STORAGE_IN_RANGE(addr, len)         (((unsigned long)(addr) + (len)) <= STORAGE_SIZE)
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+#if STORAGE_BACKEND == STORAGE_BACKEND_E2PEXT
+/*------------------------------------------------------------------*
+ * External EEPROM backend
+ * Page writes and sequential reads with ACK polling (see eeprom_ext.c).
+-*------------------------------------------------------------------*/
+void storage_init(void)
+{
+    e2pext_init();
+}
+
+unsigned char storage_read_block(unsigned int addr, unsigned char *buf, unsigned char len)
+{
+    if(!STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    return (e2pext_read_block(addr, buf, len) == E2PEXT_OK) ? STORAGE_OK : STORAGE_ERROR;
+}
+
+unsigned char storage_write_block(unsigned int addr, const unsigned char *buf, unsigned char len)
+{
+    if(!STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    return (e2pext_write_block(addr, buf, len) == E2PEXT_OK) ? STORAGE_OK : STORAGE_ERROR;
+}
+
+unsigned char storage_wait_ready(void)
+{
+    return (e2pext_wait_ready() == E2PEXT_OK) ? STORAGE_OK : STORAGE_ERROR;
+}
+
+unsigned int storage_get_errors(void)
+{
+    return e2pext_get_errors();
+}
+
+#elif STORAGE_BACKEND == STORAGE_BACKEND_INT
+/*------------------------------------------------------------------*
+ * Internal data EEPROM backend
+ * Reads take a few cycles and need no bus. The memory has no page
+ * buffer, eeprom_write() waits for the previous byte (about 4ms each)
+ * so only the last byte of a block is left running when it returns. The
+ * watchdog is kicked per byte as a block takes longer than its period.
+-*------------------------------------------------------------------*/
+void storage_init(void)
+{
+}
+
+unsigned char storage_read_block(unsigned int addr, unsigned char *buf, unsigned char len)
+{
+    if(!STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    while(len--)
+    {
+        *buf++ = eeprom_read((unsigned char)addr++);
+    }
+    return STORAGE_OK;
+}
+
+unsigned char storage_write_block(unsigned int addr, const unsigned char *buf, unsigned char len)
+{
+    if(!STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    while(len--)
+    {
+        CLRWDT();       // every byte waits for the previous write cycle
+        eeprom_write((unsigned char)addr++, *buf++);
+    }
+    return STORAGE_OK;
+}
+
+unsigned char storage_wait_ready(void)
+{
+    while(EECON1bits.WR);
+    return STORAGE_OK;
+}
+
+unsigned int storage_get_errors(void)
+{
+    return 0;
+}
+
+#elif STORAGE_BACKEND == STORAGE_BACKEND_FILE
+/*------------------------------------------------------------------*
+ * File backed mock
+ * The memory image is kept in STORAGE_FILE_NAME, a missing file is
+ * created erased (0xFF) like a new EEPROM. Every write is handed to
+ * storage_file_hook when it is set.
+-*------------------------------------------------------------------*/
+static FILE *storage_fp = NULL;
+void (*storage_file_hook)(unsigned int addr, const unsigned char *buf, unsigned char len) = NULL;
+
+void storage_init(void)
+{
+    unsigned int i;
+
+    storage_fp = fopen(STORAGE_FILE_NAME, "r+b");
+    if(storage_fp == NULL)
+    {
+        storage_fp = fopen(STORAGE_FILE_NAME, "w+b");
+        for(i = 0 ; storage_fp != NULL && i < STORAGE_SIZE ; i++)
+        {
+            fputc(0xFF, storage_fp);
+        }
+    }
+}
+
+unsigned char storage_read_block(unsigned int addr, unsigned char *buf, unsigned char len)
+{
+    if(storage_fp == NULL || !STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    if(fseek(storage_fp, addr, SEEK_SET) != 0 || fread(buf, 1, len, storage_fp) != len)
+    {
+        return STORAGE_ERROR;
+    }
+    return STORAGE_OK;
+}
+
+unsigned char storage_write_block(unsigned int addr, const unsigned char *buf, unsigned char len)
+{
+    if(storage_fp == NULL || !STORAGE_IN_RANGE(addr, len))
+    {
+        return STORAGE_ERROR;
+    }
+    if(fseek(storage_fp, addr, SEEK_SET) != 0 || fwrite(buf, 1, len, storage_fp) != len)
+    {
+        return STORAGE_ERROR;
+    }
+    fflush(storage_fp);
+    if(storage_file_hook != NULL)
+    {
+        storage_file_hook(addr, buf, len);
+    }
+    return STORAGE_OK;
+}
+
+unsigned char storage_wait_ready(void)
+{
+    return (storage_fp != NULL) ? STORAGE_OK : STORAGE_ERROR;
+}
+
+unsigned int storage_get_errors(void)
+{
+    return 0;
+}
+#endif
+
+/*------------------------------------------------------------------*
+ * storage_r(unsigned int addr)
+ * This function reads one byte, 0xFF (erased) is returned on error.
+-*------------------------------------------------------------------*/
+unsigned char storage_r(unsigned int addr)
+{
+    unsigned char ret = 0xFF;
+
+    storage_read_block(addr, &ret, 1);
+    return ret;
+}
+
+/*------------------------------------------------------------------*
+ * storage_w(unsigned int addr, unsigned char val)
+ * This function writes one byte.
+-*------------------------------------------------------------------*/
+void storage_w(unsigned int addr, unsigned char val)
+{
+    storage_write_block(addr, &val, 1);
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,133 @@
+/****************************************************************************
+* Title                 :   Storage
+* Filename              :   storage.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   The backend is selected by STORAGE_BACKEND in config_EW_Heater.h
+*******************************************************************************/
+/** \file   storage.h
+ *  \brief  This file contains the non volatile storage interface used by the
+ *          settings store and the logger.
+ *
+ *  Every backend has the same semantics:
+ *      - addresses run from 0 to STORAGE_SIZE - 1.
+ *      - a block write returns once the data is handed to the memory, the
+ *        next access (or storage_wait_ready()) waits for it to be committed.
+ *      - a block write never spans more than the pages it addresses, callers
+ *        that need an atomic record keep it inside one STORAGE_PAGE_SIZE page.
+ */
+
+#ifndef __STORAGE_H__
+#define __STORAGE_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define STORAGE_OK                          0
+#define STORAGE_ERROR                       1
+
+#define STORAGE_PAGE_SIZE                   16
+
+#if STORAGE_BACKEND == STORAGE_BACKEND_INT
+#define STORAGE_SIZE                        256     // PIC16F877A data EEPROM
+#else
+#define STORAGE_SIZE                        512     // 24C04 (also the size of the file mock)
+#endif
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+#if STORAGE_BACKEND == STORAGE_BACKEND_FILE
+/* called after every write of the file mock so a host tool can trace it */
+extern void (*storage_file_hook)(unsigned int addr, const unsigned char *buf, unsigned char len);
+#endif
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * storage_init()
+ *
+ * @brief This function initializes the hardware of the selected backend.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void storage_init(void);
+
+/**
+ * storage_read_block()
+ *
+ * @brief This function reads (len) bytes starting at (addr).
+ *
+ * @param <unsigned int addr> the address of the first byte
+ * @param <unsigned char *buf> the buffer the data is copied to
+ * @param <unsigned char len> the number of bytes to read
+ * @return <unsigned char> STORAGE_OK or STORAGE_ERROR
+ */
+unsigned char storage_read_block(unsigned int addr, unsigned char *buf, unsigned char len);
+
+/**
+ * storage_write_block()
+ *
+ * @brief This function writes (len) bytes starting at (addr).
+ *
+ * @param <unsigned int addr> the address of the first byte
+ * @param <const unsigned char *buf> the data to be saved
+ * @param <unsigned char len> the number of bytes to write
+ * @return <unsigned char> STORAGE_OK or STORAGE_ERROR
+ */
+unsigned char storage_write_block(unsigned int addr, const unsigned char *buf, unsigned char len);
+
+/**
+ * storage_wait_ready()
+ *
+ * @brief This function blocks until the last write is committed.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> STORAGE_OK or STORAGE_ERROR
+ */
+unsigned char storage_wait_ready(void);
+
+/**
+ * storage_get_errors()
+ *
+ * @brief This function gets the failed accesses since the reset (memory not
+ *        answering or not acknowledging a byte), 0 for the backends
+ *        without a bus.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int> the errors, saturated at 0xFFFF
+ */
+unsigned int storage_get_errors(void);
+
+/**
+ * storage_r()
+ *
+ * @brief This function reads one byte.
+ *
+ * @param <unsigned int addr> the address of the byte
+ * @return <unsigned char> the byte read (0xFF if the memory did not answer)
+ */
+unsigned char storage_r(unsigned int addr);
+
+/**
+ * storage_w()
+ *
+ * @brief This function writes one byte.
+ *
+ * @param <unsigned int addr> the address of the byte
+ * @param <unsigned char val> the data to be saved
+ * @return <void>
+ */
+void storage_w(unsigned int addr, unsigned char val);
+
+#endif
+/*** End of File **************************************************************/
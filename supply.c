@@ -0,0 +1,72 @@
+/****************************************************************************
+* Title                 :   Supply Monitor
+* Filename              :   supply.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Threshold and channel can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   supply.c
+ *  \brief  This file contains the supply voltage monitor used as a power fail
+ *          early warning.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+#include "supply.h"
+#include "adc.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static unsigned int Supply = 0;
+static unsigned char SUPPLY_CH = 0;
+static unsigned char low_cnt = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * supply_init()
+ * This function sets the ADC channel of the supply divider.
+-*------------------------------------------------------------------*/
+void supply_init( unsigned char ADCcanal )
+{
+    SUPPLY_CH = ADCcanal;
+    low_cnt = 0;
+}
+
+/*------------------------------------------------------------------*
+ * supply_is_low()
+ * This function samples the supply, a single low sample (relay switching
+ * spike) is ignored, SUPPLY_LOW_SAMPLES low samples in a row are a power fail.
+-*------------------------------------------------------------------*/
+unsigned char supply_is_low(void)
+{
+    Supply = adc_get(SUPPLY_CH);
+    if(Supply < SUPPLY_LOW_THRESHOLD)
+    {
+        if(low_cnt < SUPPLY_LOW_SAMPLES)
+        {
+            low_cnt++;
+        }
+    }
+    else
+    {
+        low_cnt = 0;
+    }
+    return (low_cnt >= SUPPLY_LOW_SAMPLES);
+}
+
+/*------------------------------------------------------------------*
+ * supply_get()
+ * This function gets the last supply reading in ADC counts.
+-*------------------------------------------------------------------*/
+unsigned int supply_get(void)
+{
+    return Supply;
+}
+/*** End of File **************************************************************/
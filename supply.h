@@ -0,0 +1,56 @@
+/****************************************************************************
+* Title                 :   Supply Monitor
+* Filename              :   supply.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Threshold and channel can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   supply.h
+ *  \brief  This file contains the supply voltage monitor used as a power fail
+ *          early warning. The unregulated supply is read through a divider on
+ *          a spare ADC channel, it falls well before the regulated 5V so the
+ *          warning comes while the hold-up capacitor still powers the MCU.
+ */
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+#ifndef __SUPPLY_H__
+#define __SUPPLY_H__
+
+/**
+ * supply_init()
+ *
+ * @brief This function sets the ADC channel of the supply divider, the ADC
+ *        itself is initialized by the temperature sensor.
+ *
+ * @param <ADCcanal> the ADC channel of the supply divider
+ * @return <void>
+ */
+void supply_init( unsigned char ADCcanal );
+
+/**
+ * supply_is_low()
+ *
+ * @brief This function samples the supply and reports a power fail once it
+ *        was below SUPPLY_LOW_THRESHOLD for SUPPLY_LOW_SAMPLES samples in a row.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> 1 on power fail, 0 otherwise
+ */
+unsigned char supply_is_low(void);
+
+/**
+ * supply_get()
+ *
+ * @brief This function gets the last supply reading in ADC counts.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int>
+ */
+unsigned int supply_get(void);
+
+#endif
+/*** End of File **************************************************************/
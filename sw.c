@@ -5,7 +5,7 @@
 * Origin Date           :   08/07/2020
 * Version               :   1.0.0
 *
-* Notes                 :   None
+* Notes                 :   Debounce and long press times can be configured from config_EW_Heater.h
 *******************************************************************************/
 /** \file   sw.c
  *  \brief  This file contains the control functions for switches.
@@ -14,8 +14,35 @@
 /******************************************************************************
 * Includes
 *******************************************************************************/
+#include "config_EW_Heater.h"
 #include "sw.h"
 #include "port.h"
+#include "int.h"
+#include "sch.h"
+#include "record.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define SW_LONG_TICKS       (SW_LONG_PRESS_TIME / SCH_TICK)
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * Vertical counters: bit n of sw_cnt0/sw_cnt1 is the 2 bit counter of
+ * line n, it counts the ticks the raw line differs from its debounced
+ * state in (sw_state) and is cleared as soon as they agree again.
+ * sw_state holds 1 for a pressed line (the raw port is active low).
+ * The edge masks are set by the ISR and cleared by the reading task.
+ * sw_lines masks the initialized switches, the other pins of the port
+ * (the heat LED output) must not look like edges or end a long press.
+-*------------------------------------------------------------------*/
+static unsigned char sw_cnt0 = 0 , sw_cnt1 = 0;
+static volatile unsigned char sw_state = 0;
+static volatile unsigned char sw_press = 0 , sw_release = 0 , sw_long = 0;
+static unsigned int sw_hold = 0;
+static unsigned char sw_lines = 0;
 
 /******************************************************************************
 * Functions
@@ -28,6 +55,7 @@
 void sw_init(unsigned char sw_msk)
 {
     SW_IO_REG |= sw_msk;
+    sw_lines |= sw_msk;
     PULLUP = 0; //Pull up pin is active low so it must be cleared
 }
 
@@ -47,4 +75,112 @@ unsigned char sw_is_pressed(unsigned char sw)
         return DEPRESSED;
     }
 }
-/*** End of File **************************************************************/
\ No newline at end of file
+
+/*------------------------------------------------------------------*
+ * sw_debounce_isr()
+ * This function is called by the scheduler tick ISR. It samples the whole
+ * switch port once and debounces the 8 lines together, a line changes its
+ * state after 4 equal samples (SCH_TICK * 4 ms). Counting one bit of every
+ * counter at a time costs the same few instructions for 1 or 8 lines.
+ * It returns the lines with a new edge so the ISR posts an event only then.
+-*------------------------------------------------------------------*/
+unsigned char sw_debounce_isr(void)
+{
+    unsigned char raw , delta , toggle;
+    
+    raw = SW_PORT;
+    REC_PORTB(raw);
+    delta = ((unsigned char)~raw ^ sw_state) & sw_lines;    // lines that differ from their state
+    sw_cnt1 = (sw_cnt1 ^ sw_cnt0) & delta;          // count up, clear the agreeing lines
+    sw_cnt0 = ~sw_cnt0 & delta;
+    toggle = delta & ~(sw_cnt0 | sw_cnt1);          // counters that rolled over to 0
+    sw_state ^= toggle;
+    
+    sw_press |= toggle & sw_state;
+    sw_release |= toggle & ~sw_state;
+    
+    /* Long press: the held lines did not change for SW_LONG_PRESS_TIME */
+    if(toggle)
+    {
+        sw_hold = 0;
+    }
+    else if(sw_state && sw_hold < SW_LONG_TICKS)
+    {
+        sw_hold++;
+        if(sw_hold == SW_LONG_TICKS)
+        {
+            sw_long |= sw_state;
+            return sw_state;
+        }
+    }
+    return toggle;
+}
+
+/*------------------------------------------------------------------*
+ * sw_get_press(unsigned char sw_msk)
+ * This function returns and clears the press edges of the masked lines.
+-*------------------------------------------------------------------*/
+unsigned char sw_get_press(unsigned char sw_msk)
+{
+    unsigned char ret;
+    
+    Disable_Global_INT();
+    ret = sw_press & sw_msk;
+    sw_press &= ~ret;
+    Enable_Global_INT();
+    return ret;
+}
+
+/*------------------------------------------------------------------*
+ * sw_get_release(unsigned char sw_msk)
+ * This function returns and clears the release edges of the masked lines.
+-*------------------------------------------------------------------*/
+unsigned char sw_get_release(unsigned char sw_msk)
+{
+    unsigned char ret;
+    
+    Disable_Global_INT();
+    ret = sw_release & sw_msk;
+    sw_release &= ~ret;
+    Enable_Global_INT();
+    return ret;
+}
+
+/*------------------------------------------------------------------*
+ * sw_get_long(unsigned char sw_msk)
+ * This function returns and clears the long press edges of the masked lines.
+-*------------------------------------------------------------------*/
+unsigned char sw_get_long(unsigned char sw_msk)
+{
+    unsigned char ret;
+    
+    Disable_Global_INT();
+    ret = sw_long & sw_msk;
+    sw_long &= ~ret;
+    Enable_Global_INT();
+    return ret;
+}
+
+/*------------------------------------------------------------------*
+ * sw_is_down(unsigned char sw_msk)
+ * This function returns the debounced pressed lines of the mask.
+-*------------------------------------------------------------------*/
+unsigned char sw_is_down(unsigned char sw_msk)
+{
+    return sw_state & sw_msk;
+}
+
+/*------------------------------------------------------------------*
+ * sw_clear_edges()
+ * This function drops the pending edges (used after a wake up, the
+ * edges collected before the sleep are stale).
+-*------------------------------------------------------------------*/
+void sw_clear_edges(void)
+{
+    Disable_Global_INT();
+    sw_press = 0;
+    sw_release = 0;
+    sw_long = 0;
+    Enable_Global_INT();
+}
+/*** End of File **************************************************************/
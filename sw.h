@@ -41,5 +41,61 @@ void sw_init(unsigned char sw_msk);
  */
 unsigned char sw_is_pressed(unsigned char sw);
 
+/**
+ * @brief Debounces the initialized lines of the switch port, called every
+ *        scheduler tick by the ISR
+ *
+ * @param <void> takes no arguments
+ *
+ * @return <unsigned char> the lines with a new press / release / long press edge
+ */
+unsigned char sw_debounce_isr(void);
+
+/**
+ * @brief Gets and clears the press edges of the masked switches
+ *
+ * @param <sw_msk> a mask for the switch pins
+ *
+ * @return <unsigned char> the switches pressed since the last call
+ */
+unsigned char sw_get_press(unsigned char sw_msk);
+
+/**
+ * @brief Gets and clears the release edges of the masked switches
+ *
+ * @param <sw_msk> a mask for the switch pins
+ *
+ * @return <unsigned char> the switches released since the last call
+ */
+unsigned char sw_get_release(unsigned char sw_msk);
+
+/**
+ * @brief Gets and clears the long press edges of the masked switches, a
+ *        switch held for SW_LONG_PRESS_TIME reports one long press
+ *
+ * @param <sw_msk> a mask for the switch pins
+ *
+ * @return <unsigned char> the switches long pressed since the last call
+ */
+unsigned char sw_get_long(unsigned char sw_msk);
+
+/**
+ * @brief Gets the debounced state of the masked switches
+ *
+ * @param <sw_msk> a mask for the switch pins
+ *
+ * @return <unsigned char> the masked switches that are held down
+ */
+unsigned char sw_is_down(unsigned char sw_msk);
+
+/**
+ * @brief Drops all the pending switch edges
+ *
+ * @param <void> takes no arguments
+ *
+ * @return <void>
+ */
+void sw_clear_edges(void);
+
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -0,0 +1,71 @@
+/****************************************************************************
+* Title                 :   Telemetry
+* Filename              :   telem.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Rate can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   telem.c
+ *  \brief  This file contains the framing of the binary telemetry.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "telem.h"
+#include "usart.h"
+#include "crc.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static unsigned char telem_frame[TELEM_MAX_PAYLOAD + TELEM_OVERHEAD];
+static unsigned char telem_dropped = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * telem_send()
+ * The frame is built in RAM and queued with a single usart_write(), the
+ * bytes leave from the TXIF interrupt so the caller never waits for the
+ * line (a status frame is 15 bytes, ~8ms at 19200 baud).
+-*------------------------------------------------------------------*/
+unsigned char telem_send(unsigned char type, const unsigned char *payload, unsigned char len)
+{
+    unsigned char i;
+
+    if(len > TELEM_MAX_PAYLOAD)
+    {
+        return TELEM_ERROR;
+    }
+    telem_frame[0] = TELEM_SOF;
+    telem_frame[1] = len + 1;
+    telem_frame[2] = type;
+    for(i = 0 ; i < len ; i++)
+    {
+        telem_frame[3 + i] = payload[i];
+    }
+    telem_frame[3 + len] = crc8(&telem_frame[1], len + 2);
+    if(usart_write(telem_frame, len + TELEM_OVERHEAD) != USART_OK)
+    {
+        if(telem_dropped < 0xFF)
+        {
+            telem_dropped++;
+        }
+        return TELEM_ERROR;
+    }
+    return TELEM_OK;
+}
+
+/*------------------------------------------------------------------*
+ * telem_get_dropped()
+ * This function gets the number of frames dropped.
+-*------------------------------------------------------------------*/
+unsigned char telem_get_dropped(void)
+{
+    return telem_dropped;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,100 @@
+/****************************************************************************
+* Title                 :   Telemetry
+* Filename              :   telem.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Rate can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   telem.h
+ *  \brief  This file contains the framing of the binary telemetry sent over
+ *          the USART (decoded on the host by tools/telem_decode.c).
+ *
+ *  Frame: SOF, len, type, payload[len - 1], crc
+ *      - len counts the type byte and the payload.
+ *      - crc is the crc8() of len, type and the payload.
+ *  Multi byte fields are little endian.
+ */
+
+#ifndef __TELEM_H__
+#define __TELEM_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define TELEM_OK                            0
+#define TELEM_ERROR                         1
+
+#define TELEM_SOF                           0xA5
+#define TELEM_OVERHEAD                      4       // SOF, len, type, crc
+#define TELEM_MAX_PAYLOAD                   16
+
+/*------------------------------------------------------------------*
+ * Frame types
+-*------------------------------------------------------------------*/
+#define TELEM_TYPE_STATUS                   0x01
+#define TELEM_TYPE_BENCH                    0x02    // BENCH_ENABLE builds only
+
+/*------------------------------------------------------------------*
+ * TELEM_TYPE_STATUS payload
+-*------------------------------------------------------------------*/
+#define TELEM_ST_TEMP                       0       // 2 bytes, current reading
+#define TELEM_ST_AVG                        2       // 2 bytes, filtered average
+#define TELEM_ST_DTEMP                      4
+#define TELEM_ST_FLAGS                      5
+#define TELEM_ST_ERROR                      6       // SCH_Get_Error()
+#define TELEM_ST_OVERRUNS                   7       // sum of SCH_Get_Overruns()
+#define TELEM_ST_WDT_RESETS                 8
+#define TELEM_ST_STALLED                    9
+#define TELEM_ST_SEQ                        10
+#define TELEM_ST_LOAD                       11      // SCH_Get_Load(), percent
+#define TELEM_ST_ISR_LOAD                   12      // SCH_Get_ISR_Load(), percent
+#define TELEM_ST_PEAK                       13      // 2 bytes, SCH_Get_Peak_Busy()
+#define TELEM_ST_SIZE                       15
+
+#define TELEM_FLAG_HEATER                   0x01
+#define TELEM_FLAG_COOLER                   0x02
+#define TELEM_FLAG_SET_MODE                 0x04
+#define TELEM_FLAG_SENSOR_FAULT             0x08    // temp_get_fault()
+
+/*------------------------------------------------------------------*
+ * TELEM_TYPE_BENCH payload, one routine per frame (see bench.h)
+-*------------------------------------------------------------------*/
+#define TELEM_BN_ID                         0
+#define TELEM_BN_CYCLES                     1       // 2 bytes, longest time in cycles
+#define TELEM_BN_SIZE                       3
+
+/*------------------------------------------------------------------*
+ * Host commands (single bytes received by the telemetry task)
+-*------------------------------------------------------------------*/
+#define TELEM_CMD_TRACE                     'T'     // dump the event trace ring
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * telem_send()
+ *
+ * @brief This function frames a payload and queues it on the USART. The
+ *        frame is dropped whole when the TX ring has no room for it.
+ *
+ * @param <unsigned char type> the frame type
+ * @param <const unsigned char *payload> the frame data
+ * @param <unsigned char len> the payload size, up to TELEM_MAX_PAYLOAD
+ * @return <unsigned char> TELEM_OK or TELEM_ERROR if the frame was dropped
+ */
+unsigned char telem_send(unsigned char type, const unsigned char *payload, unsigned char len);
+
+/**
+ * telem_get_dropped()
+ *
+ * @brief This function gets the number of frames dropped (saturates at 255).
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char>
+ */
+unsigned char telem_get_dropped(void);
+
+#endif
+/*** End of File **************************************************************/
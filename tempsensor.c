@@ -14,6 +14,7 @@
 /******************************************************************************
 * Includes
 *******************************************************************************/
+#include "config_EW_Heater.h"
 #include "tempsensor.h"
 #include "adc.h"
 
@@ -22,6 +23,10 @@
 *******************************************************************************/
 static unsigned short Temp = 0;
 static unsigned char ADC_CH = 0;
+static unsigned int Raw = 0;
+static unsigned char fault_cnt = 0;
+static unsigned int cal_gain = TEMP_CAL_GAIN_DEFAULT;
+static int cal_offset = TEMP_CAL_OFFSET_DEFAULT;
 
 /******************************************************************************
 * Functions
@@ -40,12 +45,110 @@ void temp_sensor_init( unsigned char ADCcanal )
 /*------------------------------------------------------------------*
  * temp_update()
  * This function updates the global variable (Temp) with the current sensor
- * reading after calculating the temp in celsius from the equation (((ADC return value)*100)/204).
+ * reading after calculating the temp in celsius from the equation
+ * (((ADC return value) * gain + offset) >> TEMP_CAL_SHIFT). The coefficients
+ * are precomputed by temp_cal_compute(), there is no divide per sample.
 -*------------------------------------------------------------------*/
 void temp_update(void)
 {
-    Temp = ((adc_get(ADC_CH)*100)/204);
+    long t;
+
+    Raw = adc_get(ADC_CH);
+    t = (long)Raw * cal_gain + cal_offset;
+    Temp = (t > 0) ? (unsigned short)(t >> TEMP_CAL_SHIFT) : 0;
+    /* A reading outside the range of a water tank is a sensor or wiring fault */
+    if(Raw < TEMP_FAULT_RAW_LOW || Raw > TEMP_FAULT_RAW_HIGH)
+    {
+        if(fault_cnt < TEMP_FAULT_SAMPLES)
+        {
+            fault_cnt++;
+        }
+    }
+    else
+    {
+        fault_cnt = 0;
+    }
+}
+/*------------------------------------------------------------------*
+ * temp_get_raw()
+ * This function gets the last sensor reading in ADC counts.
+-*------------------------------------------------------------------*/
+unsigned int temp_get_raw(void)
+{
+    return Raw;
+}
+
+/*------------------------------------------------------------------*
+ * temp_get_fault()
+ * This function reports a sensor fault once TEMP_FAULT_SAMPLES readings in
+ * a row were out of range, a single spike is ignored. An open sensor reads
+ * as a frozen tank and a shorted one as a boiling tank, neither can be
+ * told from a real temperature by the converted value alone.
+-*------------------------------------------------------------------*/
+unsigned char temp_get_fault(void)
+{
+    if(fault_cnt < TEMP_FAULT_SAMPLES)
+    {
+        return TEMP_FAULT_NONE;
+    }
+    return (Raw < TEMP_FAULT_RAW_LOW) ? TEMP_FAULT_LOW : TEMP_FAULT_HIGH;
+}
+
+/*------------------------------------------------------------------*
+ * temp_set_cal()
+ * This function sets the conversion coefficients, out of bounds values
+ * load the defaults.
+-*------------------------------------------------------------------*/
+void temp_set_cal(unsigned int gain, int offset)
+{
+    if(gain < TEMP_CAL_GAIN_MIN || gain > TEMP_CAL_GAIN_MAX ||
+       offset > TEMP_CAL_OFFSET_MAX || offset < -TEMP_CAL_OFFSET_MAX)
+    {
+        gain = TEMP_CAL_GAIN_DEFAULT;
+        offset = TEMP_CAL_OFFSET_DEFAULT;
+    }
+    cal_gain = gain;
+    cal_offset = offset;
 }
+
+/*------------------------------------------------------------------*
+ * temp_cal_compute()
+ * This function computes the line through two reference points:
+ *      gain   = (t2 - t1) / (raw2 - raw1)
+ *      offset = t1 - raw1 * gain + 0.5
+ * both << TEMP_CAL_SHIFT, the half degree makes the truncating shift of
+ * temp_update() round to the nearest degree.
+-*------------------------------------------------------------------*/
+unsigned char temp_cal_compute(unsigned int raw1, unsigned char t1, unsigned int raw2, unsigned char t2,
+                               unsigned int *gain, int *offset)
+{
+    unsigned int span;
+    unsigned char t;
+    unsigned long g;
+    long o;
+
+    if(t1 > t2)
+    {
+        span = raw1; raw1 = raw2; raw2 = span;      // the low point first
+        t = t1; t1 = t2; t2 = t;
+    }
+    if(t2 - t1 < TEMP_CAL_MIN_SPAN || raw2 <= raw1)
+    {
+        return TEMP_CAL_ERROR;
+    }
+    span = raw2 - raw1;
+    g = (((unsigned long)(t2 - t1) << (TEMP_CAL_SHIFT + TEMP_CAL_RAW_SHIFT)) + span / 2) / span;
+    o = ((long)t1 << TEMP_CAL_SHIFT) + (1 << (TEMP_CAL_SHIFT - 1))
+        - (long)(((unsigned long)raw1 * g) >> TEMP_CAL_RAW_SHIFT);
+    if(g < TEMP_CAL_GAIN_MIN || g > TEMP_CAL_GAIN_MAX || o > TEMP_CAL_OFFSET_MAX || o < -TEMP_CAL_OFFSET_MAX)
+    {
+        return TEMP_CAL_ERROR;
+    }
+    *gain = (unsigned int)g;
+    *offset = (int)o;
+    return TEMP_CAL_OK;
+}
+
 /*------------------------------------------------------------------*
  * get_temp()
  * This function gets the last temperature reading.
@@ -11,11 +11,22 @@
  *  \brief  This file contains the temperature sensor controls.
  */
 
+#ifndef __TEMPSENSOR_H__
+#define __TEMPSENSOR_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define TEMP_FAULT_NONE                     0
+#define TEMP_FAULT_LOW                      1       // open sensor / short to ground
+#define TEMP_FAULT_HIGH                     2       // short to the supply
+
+#define TEMP_CAL_OK                         0
+#define TEMP_CAL_ERROR                      1
+
 /******************************************************************************
 * Function Prototypes
 *******************************************************************************/
-#ifndef __TEMPSENSOR_H__
-#define __TEMPSENSOR_H__
 
 /**
  * temp_sensor_init()
@@ -33,7 +44,8 @@ void temp_sensor_init( unsigned char ADCcanal );
  * 
  * @brief This function updates the global variable (Temp) with the current sensor
  *        reading after calculating the temp in celsius from the equation
- *        (((ADC return value)*100)/204).
+ *        (((ADC return value) * gain + offset) >> TEMP_CAL_SHIFT), the default
+ *        gain is the ideal LM35 (100/204).
  *
  * @param <void> 
  * @return <void>
@@ -49,5 +61,56 @@ void temp_update(void);
  * @return <unsigned short>
  */
 unsigned short get_temp(void);
+
+/**
+ * temp_get_raw()
+ * 
+ * @brief This function gets the last sensor reading in ADC counts.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned int> 0 - 1023
+ */
+unsigned int temp_get_raw(void);
+
+/**
+ * temp_get_fault()
+ * 
+ * @brief This function reports a sensor reading out of the range
+ *        TEMP_FAULT_RAW_LOW - TEMP_FAULT_RAW_HIGH for TEMP_FAULT_SAMPLES
+ *        readings in a row.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned char> TEMP_FAULT_NONE, TEMP_FAULT_LOW or TEMP_FAULT_HIGH
+ */
+unsigned char temp_get_fault(void);
+
+/**
+ * temp_set_cal()
+ * 
+ * @brief This function sets the coefficients used by temp_update(), values
+ *        outside TEMP_CAL_GAIN_MIN - TEMP_CAL_GAIN_MAX or +-TEMP_CAL_OFFSET_MAX
+ *        (a blank or old settings record) load the defaults instead.
+ *
+ * @param <unsigned int gain> C per ADC count << TEMP_CAL_SHIFT
+ * @param <int offset> C << TEMP_CAL_SHIFT
+ * @return <void>
+ */
+void temp_set_cal(unsigned int gain, int offset);
+
+/**
+ * temp_cal_compute()
+ * 
+ * @brief This function computes the coefficients of the line through two
+ *        reference points, in either order. The divides are done here once
+ *        so the sample path is a multiply and a shift.
+ *
+ * @param <unsigned int raw1, raw2> readings in 1 / (1 << TEMP_CAL_RAW_SHIFT) ADC counts
+ * @param <unsigned char t1, t2> reference temperatures in C
+ * @param <unsigned int *gain, int *offset> the coefficients for temp_set_cal()
+ * @return <unsigned char> TEMP_CAL_OK, TEMP_CAL_ERROR when the points are
+ *         less than TEMP_CAL_MIN_SPAN apart or the result is out of bounds
+ */
+unsigned char temp_cal_compute(unsigned int raw1, unsigned char t1, unsigned int raw2, unsigned char t2,
+                               unsigned int *gain, int *offset);
 #endif
 /*** End of File **************************************************************/
\ No newline at end of file
@@ -0,0 +1,210 @@
+/****************************************************************************
+* Title                 :   Benchmark Check
+* Filename              :   bench_check.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with:
+*                           cc -I.. -o bench_check bench_check.c ../crc.c
+*******************************************************************************/
+/** \file   bench_check.c
+ *  \brief  This file reads the telemetry of a BENCH_ENABLE build and checks
+ *          the longest time of every routine against BENCH_BUDGETS.
+ *
+ *  usage: bench_check [-u] [-r rounds] <device|file|->
+ *  The unit sends one routine per telemetry period, the tool waits for
+ *  (rounds) reports of every routine (default 2, the first report can come
+ *  before the routine ran under load). It prints one line per routine and
+ *  exits with 1 when a routine is over its budget. A routine that reports
+ *  0 was not measured (no external EEPROM) and is not checked.
+ *  -u prints a BENCH_BUDGETS line of the measured times plus 25% for bench.h.
+ *  tools/bench_host.sh runs it on the telemetry of a host build.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "crc.h"
+#include "telem.h"
+#include "bench.h"
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static const char *names[BENCH_NUM] =
+{
+    "isr_tick", "dispatch", "temp_update", "temp_avg", "ssd_task",
+    "i2c_wb", "i2c_rb", "e2p_r", "e2p_w"
+};
+static const unsigned int budgets[BENCH_NUM] = BENCH_BUDGETS;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * open_port()
+ * Opens the input, a terminal is switched to raw mode at 19200 baud.
+-*------------------------------------------------------------------*/
+static int open_port(const char *name)
+{
+    struct termios tio;
+    int fd = strcmp(name, "-") ? open(name, O_RDONLY | O_NOCTTY) : 0;
+
+    if(fd >= 0 && isatty(fd) && tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B19200);
+        cfsetospeed(&tio, B19200);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+/*------------------------------------------------------------------*
+ * get_byte()
+ * Reads one byte, -1 at the end of the input.
+-*------------------------------------------------------------------*/
+static int get_byte(int fd)
+{
+    unsigned char c;
+
+    return (read(fd, &c, 1) == 1) ? c : -1;
+}
+
+/*------------------------------------------------------------------*
+ * read_frame()
+ * Reads the next valid frame into (frame) as len, type, payload.
+ * Returns the frame length, 0 at the end of the input.
+-*------------------------------------------------------------------*/
+static unsigned read_frame(int fd, unsigned char *frame)
+{
+    int c, i;
+    unsigned len;
+
+    while((c = get_byte(fd)) >= 0)
+    {
+        if(c != TELEM_SOF || (c = get_byte(fd)) < 0)
+        {
+            continue;
+        }
+        len = c;
+        if(len == 0 || len > TELEM_MAX_PAYLOAD + 1)
+        {
+            continue;       // not a frame, look for the next SOF
+        }
+        frame[0] = len;
+        for(i = 1 ; i <= (int)len + 1 && (c = get_byte(fd)) >= 0 ; i++)
+        {
+            frame[i] = c;
+        }
+        if(c < 0)
+        {
+            break;
+        }
+        if(crc8(frame, len + 1) == frame[len + 1])
+        {
+            return len;
+        }
+        fprintf(stderr, "bad crc\n");
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char frame[TELEM_MAX_PAYLOAD + TELEM_OVERHEAD];
+    unsigned int cycles[BENCH_NUM] = { 0 };
+    unsigned int seen[BENCH_NUM] = { 0 };
+    unsigned int rounds = 2, done = 0, fail = 0, id, c;
+    unsigned len;
+    int fd, opt, update = 0;
+
+    while((opt = getopt(argc, argv, "ur:")) != -1)
+    {
+        if(opt == 'u')
+        {
+            update = 1;
+        }
+        else if(opt == 'r' && atoi(optarg) > 0)
+        {
+            rounds = atoi(optarg);
+        }
+        else
+        {
+            optind = argc + 1;      // usage
+            break;
+        }
+    }
+    if(optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-u] [-r rounds] <device|file|->\n", argv[0]);
+        return 1;
+    }
+    fd = open_port(argv[optind]);
+    if(fd < 0)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    while(done < BENCH_NUM && (len = read_frame(fd, frame)) != 0)
+    {
+        if(len != TELEM_BN_SIZE + 1 || frame[1] != TELEM_TYPE_BENCH || (id = frame[2 + TELEM_BN_ID]) >= BENCH_NUM)
+        {
+            continue;       // status frames
+        }
+        c = frame[2 + TELEM_BN_CYCLES] | (frame[2 + TELEM_BN_CYCLES + 1] << 8);
+        if(c > cycles[id])
+        {
+            cycles[id] = c;
+        }
+        if(++seen[id] == rounds)
+        {
+            done++;
+        }
+    }
+    if(done < BENCH_NUM)
+    {
+        fprintf(stderr, "input ended after %u of %u routines\n", done, BENCH_NUM);
+    }
+    printf("routine,cycles,budget,result\n");
+    for(id = 0 ; id < BENCH_NUM ; id++)
+    {
+        const char *res = "ok";
+
+        if(seen[id] == 0)
+        {
+            res = "no report";
+            fail = 1;
+        }
+        else if(cycles[id] == 0)
+        {
+            res = "not measured";
+        }
+        else if(cycles[id] > budgets[id])
+        {
+            res = "OVER BUDGET";
+            fail = 1;
+        }
+        printf("%s,%u,%u,%s\n", names[id], cycles[id], budgets[id], res);
+    }
+    if(update)
+    {
+        printf("#define BENCH_BUDGETS                       {");
+        for(id = 0 ; id < BENCH_NUM ; id++)
+        {
+            c = cycles[id] ? cycles[id] + cycles[id] / 4 : budgets[id];
+            printf(" %u%s", c, (id < BENCH_NUM - 1) ? "," : " }\n");
+        }
+    }
+    return fail;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,34 @@
+#!/bin/sh
+#****************************************************************************
+# Title                 :   Host Benchmark Check
+# Filename              :   bench_host.sh
+# Author                :   Muhammed Elkomy
+# Origin Date           :   08/07/2020
+# Version               :   1.0.0
+#
+# Notes                 :   Host tool, run from tools/: ./bench_host.sh [cc flags]
+#*****************************************************************************
+# Builds tank_sim and bench_check with BENCH_ENABLE, runs the tank for
+# BENCH_HOST_SECONDS with the telemetry written to a file and checks the
+# reports of every routine against BENCH_BUDGETS (bench.h) with
+# bench_check, 2 rounds.
+#
+# Timer 1 follows the host clock in a BENCH_ENABLE host build, so the
+# cycles are the host time in Timer 1 ticks: the check catches a probe that
+# no longer builds or reports and a routine that runs away, the budgets of
+# the target are checked on a unit with bench_check <device>. The routines
+# of the external EEPROM are not measured on the file backend.
+
+BENCH_HOST_SECONDS=30       # 9 routines, one per telemetry period, 2 rounds
+
+cd "$(dirname "$0")" || exit 2
+out=${TMPDIR:-/tmp}/bench_host.$$
+trap 'rm -rf "$out"' EXIT
+mkdir -p "$out"
+
+make -s OUT="$out" HOST_FLAGS="-DBENCH_ENABLE=1 $*" "$out/tank_sim" "$out/bench_check" 2> "$out/build.txt" || {
+    cat "$out/build.txt"
+    exit 2
+}
+(cd "$out" && ./tank_sim -u telem.bin "${BENCH_HOST_SECONDS}s" > /dev/null) || exit 2
+"$out/bench_check" -r 2 "$out/telem.bin"
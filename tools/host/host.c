@@ -0,0 +1,230 @@
+/****************************************************************************
+* Title                 :   Host Harness
+* Filename              :   host.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Linked by the host tools with the firmware, see host.mk
+*******************************************************************************/
+/** \file   host.c
+ *  \brief  This file contains the peripherals the host tools share when they
+ *          run the firmware (see host.h). The registers are the variables of
+ *          xc.h, defined here. The storage is the file backend of storage.c.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+#define HOST_REGS_DEFINE
+#include <xc.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "host.h"
+#include "storage.h"
+#include "tstamp.h"
+#include "sch.h"
+#include "bench.h"
+#include "EW_Heater.h"
+
+#if STORAGE_BACKEND != STORAGE_BACKEND_FILE
+#error "build the host tools with -DSTORAGE_BACKEND=STORAGE_BACKEND_FILE (see host.mk)"
+#endif
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+unsigned char host_clock = BENCH_ENABLE ? HOST_CLOCK_REAL : HOST_CLOCK_TICK;
+unsigned int (*host_adc)(unsigned char canal) = host_adc_nominal;
+void (*host_sleep)(void) = host_wake;
+
+static unsigned long long host_us;      // scheduler ticks run, HOST_CLOCK_TICK
+
+void ISR(void);
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * host_now_us()
+ * Monotonic time in microseconds.
+-*------------------------------------------------------------------*/
+unsigned long long host_now_us(void)
+{
+    static unsigned long long t0 = 0;
+    struct timespec ts;
+    unsigned long long now;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    if(t0 == 0)
+    {
+        t0 = now;
+    }
+    return now - t0;
+}
+
+/*------------------------------------------------------------------*
+ * host_asm()
+ * SLEEP is handed to the tool, the other instructions do nothing.
+-*------------------------------------------------------------------*/
+void host_asm(const char *op)
+{
+    if(strcmp(op, "SLEEP") == 0)
+    {
+        host_sleep();
+    }
+}
+
+/*------------------------------------------------------------------*
+ * host_wake()
+ * The power switch edge wakes the unit up at once.
+-*------------------------------------------------------------------*/
+void host_wake(void)
+{
+    INTF = 1;
+    ISR();
+}
+
+/*------------------------------------------------------------------*
+ * host_tmr1()
+ * Timer 1 free runs at TSTAMP_US_PER_TICK on the clock of host_clock,
+ * the register is refreshed on every access so writes do not stick.
+-*------------------------------------------------------------------*/
+volatile unsigned char *host_tmr1(unsigned char hi)
+{
+    static volatile unsigned char tmr1[2];
+    unsigned long long us = (host_clock == HOST_CLOCK_REAL) ? host_now_us() : host_us;
+    uint16_t t = (uint16_t)(us / TSTAMP_US_PER_TICK);
+
+    tmr1[0] = (unsigned char)t;
+    tmr1[1] = (unsigned char)(t >> 8);
+    return &tmr1[hi & 0x01];
+}
+
+/*------------------------------------------------------------------*
+ * host_adcon0bits()
+ * A conversion started with GO ends on the next access, the result of
+ * host_adc() is left justified in ADRESH:ADRESL (ADCON1 = 0x02).
+-*------------------------------------------------------------------*/
+HOST_ADCON0BITS_T *host_adcon0bits(void)
+{
+    static HOST_ADCON0BITS_T bits;
+    unsigned int val;
+
+    if(bits.GO)
+    {
+        val = host_adc((ADCON0 >> 3) & 0x07) & 0x03FF;
+        ADRESH = (unsigned char)(val >> 2);
+        ADRESL = (unsigned char)(val << 6);
+        bits.GO = 0;
+    }
+    return &bits;
+}
+
+/*------------------------------------------------------------------*
+ * host_adc_nominal()
+ * A healthy supply and a tank at INITIAL_TEMP.
+-*------------------------------------------------------------------*/
+unsigned int host_adc_nominal(unsigned char canal)
+{
+    if(canal == SUPPLY_SENSE_CH)
+    {
+        return HOST_SUPPLY_NOMINAL;
+    }
+    if(canal != TEMP_SENSOR_CH)
+    {
+        return 0;
+    }
+    return (unsigned int)(INITIAL_TEMP * HOST_COUNTS_PER_C + 0.5);
+}
+
+/*------------------------------------------------------------------*
+ * host_storage_load()
+ * The image is copied to STORAGE_FILE_NAME, the file of the storage
+ * backend, it is never written itself.
+-*------------------------------------------------------------------*/
+int host_storage_load(const char *image)
+{
+    unsigned char img[STORAGE_SIZE];
+    FILE *fp;
+    int ret = 0;
+
+    memset(img, 0xFF, sizeof(img));
+    if(image != NULL)
+    {
+        fp = fopen(image, "rb");
+        if(fp == NULL)
+        {
+            return -1;
+        }
+        if(fread(img, 1, sizeof(img), fp) == 0)
+        {
+            ret = -1;
+        }
+        fclose(fp);
+    }
+    fp = fopen(STORAGE_FILE_NAME, "wb");
+    if(fp == NULL)
+    {
+        return -1;
+    }
+    if(fwrite(img, 1, sizeof(img), fp) != sizeof(img))
+    {
+        ret = -1;
+    }
+    fclose(fp);
+    return ret;
+}
+
+/*------------------------------------------------------------------*
+ * host_boot()
+ * main() without its dispatcher loop, the switch port starts released
+ * (pull ups) with its output latches high.
+-*------------------------------------------------------------------*/
+void host_boot(void)
+{
+    PORTB = 0xFF;
+    MC_init();
+    tasks_creation();
+    pwr_hooks_creation();
+#if BENCH_ENABLE
+    bench_run();
+#endif
+    pwr_off();
+}
+
+/*------------------------------------------------------------------*
+ * host_tick()
+ * One Timer 0 overflow, it only interrupts while the scheduler runs
+ * (TMR0IE) like the recorded tick of record.h.
+-*------------------------------------------------------------------*/
+void host_tick(void)
+{
+    host_us += SCH_TICK * 1000ULL;
+    if(TMR0IE)
+    {
+        TMR0IF = 1;
+        ISR();
+    }
+}
+
+/*------------------------------------------------------------------*
+ * host_tx()
+ * TXIF is set while TXREG is empty, it is cleared again once the
+ * interrupt loaded a byte so another interrupt does not overwrite it.
+-*------------------------------------------------------------------*/
+int host_tx(void)
+{
+    if(!TXIE)
+    {
+        return -1;
+    }
+    TXIF = 1;
+    ISR();
+    TXIF = 0;
+    return TXIE ? TXREG : -1;
+}
+/*** End of File **************************************************************/
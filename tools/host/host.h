@@ -0,0 +1,123 @@
+/****************************************************************************
+* Title                 :   Host Harness
+* Filename              :   host.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Linked by the host tools with the firmware, see host.mk
+*******************************************************************************/
+/** \file   host.h
+ *  \brief  This file contains the peripherals the host tools share when they
+ *          run the firmware: the ADC, Timer 1, the USART transmitter, the
+ *          storage image and the SLEEP of pwr_off(). A tool changes the
+ *          behaviour through the hooks before host_boot(). The storage is
+ *          the STORAGE_BACKEND_FILE backend on STORAGE_FILE_NAME in the
+ *          current directory, storage_file_hook sees its writes.
+ */
+
+#ifndef __HOST_H__
+#define __HOST_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define HOST_CLOCK_TICK                     0       // Timer 1 moves SCH_TICK per host_tick(), runs repeat
+#define HOST_CLOCK_REAL                     1       // Timer 1 follows the host clock
+
+#define HOST_SUPPLY_NOMINAL                 800     // supply sense reading of a healthy mains
+#define HOST_COUNTS_PER_C                   2.046   // LM35, 5V reference
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+extern unsigned char host_clock;                                /* HOST_CLOCK_TICK, REAL with BENCH_ENABLE */
+extern unsigned int (*host_adc)(unsigned char canal);           /* host_adc_nominal by default */
+extern void (*host_sleep)(void);                                /* host_wake by default */
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * host_adc_nominal()
+ *
+ * @brief This function is the default conversion: a nominal supply and a
+ *        tank at INITIAL_TEMP.
+ *
+ * @param <unsigned char canal> the channel of ADCON0
+ * @return <unsigned int> the 10 bit result
+ */
+unsigned int host_adc_nominal(unsigned char canal);
+
+/**
+ * host_wake()
+ *
+ * @brief This function is the default SLEEP: the unit is switched on again
+ *        at once (external interrupt).
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void host_wake(void);
+
+/**
+ * host_storage_load()
+ *
+ * @brief This function writes STORAGE_FILE_NAME before host_boot(), from a
+ *        memory image or erased.
+ *
+ * @param <const char *image> the image file, NULL for an erased memory
+ * @return <int> 0, -1 if the image can not be read or the file written
+ */
+int host_storage_load(const char *image);
+
+/**
+ * host_boot()
+ *
+ * @brief This function runs main() up to its dispatcher loop, the unit is
+ *        left in the SLEEP of pwr_off() (see host_sleep). No switch is
+ *        pressed.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void host_boot(void);
+
+/**
+ * host_tick()
+ *
+ * @brief This function runs the Timer 0 interrupt of a scheduler tick if
+ *        it is enabled, the tool calls SCH_Dispatch_Tasks() after it.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void host_tick(void);
+
+/**
+ * host_tx()
+ *
+ * @brief This function runs the USART transmit interrupt once.
+ *
+ * @param <void> takes no arguments
+ * @return <int> the byte put in TXREG, -1 if there is nothing to send
+ */
+int host_tx(void);
+
+/**
+ * host_now_us()
+ *
+ * @brief This function gets the host clock.
+ *
+ * @param <void> takes no arguments
+ * @return <unsigned long long> microseconds since its first call
+ */
+unsigned long long host_now_us(void);
+
+#endif
+/*** End of File **************************************************************/
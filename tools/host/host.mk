@@ -0,0 +1,21 @@
+#****************************************************************************
+# Title                 :   Host Harness Sources
+# Filename              :   host.mk
+# Author                :   Muhammed Elkomy
+# Origin Date           :   08/07/2020
+# Version               :   1.0.0
+#
+# Notes                 :   Included by tools/Makefile, paths are relative to tools/
+#*****************************************************************************
+# The firmware sources a host tool links with host/host.c. main.c is left
+# out, host_boot() and the loop of the tool stand for it. The storage is the
+# file backend of storage.c.
+
+FW_DIR      = ..
+FW_SRC      = $(addprefix $(FW_DIR)/,sch.c int.c EW_Heater.c ssd.c sw.c heater.c \
+              cooler.c heatLED.c tempsensor.c supply.c ext_int.c pwrmgr.c tstamp.c \
+              trace.c usart.c telem.c modbus.c record.c settings.c logger.c crc.c \
+              energy.c adc.c storage.c bench.c)
+HOST_SRC    = host/host.c $(FW_SRC)
+HOST_DEPS   = $(HOST_SRC) host/host.h host/xc.h $(wildcard $(FW_DIR)/*.h)
+HOST_CFLAGS = -Ihost -I$(FW_DIR) -DSTORAGE_BACKEND=STORAGE_BACKEND_FILE
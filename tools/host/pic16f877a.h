@@ -0,0 +1,15 @@
+/****************************************************************************
+* Title                 :   Host Register Shim
+* Filename              :   pic16f877a.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Used by the host tools that link the firmware (see host.mk)
+*******************************************************************************/
+/** \file   pic16f877a.h
+ *  \brief  On a host build every register is declared by the xc.h shim.
+ */
+
+#include <xc.h>
+/*** End of File **************************************************************/
@@ -0,0 +1,104 @@
+/****************************************************************************
+* Title                 :   Host Register Shim
+* Filename              :   xc.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Used by the host tools that link the firmware (see host.mk)
+*******************************************************************************/
+/** \file   xc.h
+ *  \brief  This file stands for the XC8 header on a host build. The special
+ *          function registers and bits are plain variables owned by the tool
+ *          (defined once with HOST_REGS_DEFINE in host.c), SLEEP is handed
+ *          to the tool through host_asm(). Timer 1 and the ADC conversion
+ *          are run by host.c on every access.
+ */
+
+#ifndef __HOST_XC_H__
+#define __HOST_XC_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define __interrupt()
+#define __persistent
+#define asm(op)                             host_asm(op)
+#define CLRWDT()
+#define NOP()
+#define di()                                (GIE = 0)
+#define ei()                                (GIE = 1)
+
+#ifdef HOST_REGS_DEFINE
+#define HOST_REG(name)                      volatile unsigned char name;
+#else
+#define HOST_REG(name)                      extern volatile unsigned char name;
+#endif
+
+#define TMR1L                               (*host_tmr1(0))
+#define TMR1H                               (*host_tmr1(1))
+#define ADCON0bits                          (*host_adcon0bits())
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef struct
+{
+    unsigned char GO;
+} HOST_ADCON0BITS_T;
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+HOST_REG(PORTA) HOST_REG(PORTB) HOST_REG(PORTC) HOST_REG(PORTD) HOST_REG(PORTE)
+HOST_REG(TRISA) HOST_REG(TRISB) HOST_REG(TRISC) HOST_REG(TRISD) HOST_REG(TRISE)
+HOST_REG(TMR0) HOST_REG(T1CON) HOST_REG(TMR2) HOST_REG(PR2) HOST_REG(T2CON)
+HOST_REG(CCPR1L) HOST_REG(CCPR1H) HOST_REG(CCP1CON)
+HOST_REG(TXREG) HOST_REG(RCREG) HOST_REG(SPBRG) HOST_REG(TXSTA) HOST_REG(RCSTA)
+HOST_REG(ADCON0) HOST_REG(ADCON1) HOST_REG(ADRESH) HOST_REG(ADRESL)
+
+/* single bits */
+HOST_REG(GIE) HOST_REG(PEIE) HOST_REG(TMR0IE) HOST_REG(TMR0IF) HOST_REG(INTE) HOST_REG(INTF) HOST_REG(INTEDG)
+HOST_REG(nRBPU) HOST_REG(PS0) HOST_REG(PS1) HOST_REG(PS2) HOST_REG(PSA) HOST_REG(T0CS)
+HOST_REG(TMR1IE) HOST_REG(TMR1IF) HOST_REG(TMR1ON) HOST_REG(TMR2IE) HOST_REG(TMR2IF) HOST_REG(TMR2ON)
+HOST_REG(CCP1IE) HOST_REG(CCP1IF)
+HOST_REG(TXIE) HOST_REG(TXIF) HOST_REG(RCIE) HOST_REG(RCIF) HOST_REG(OERR) HOST_REG(CREN)
+HOST_REG(nTO) HOST_REG(nPD) HOST_REG(nPOR)
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * host_asm()
+ *
+ * @brief This function is called for every inline assembly instruction,
+ *        the tool implements SLEEP and ignores the others.
+ *
+ * @param <const char *op> the instruction
+ * @return <void>
+ */
+void host_asm(const char *op);
+
+/**
+ * host_tmr1()
+ *
+ * @brief This function gets a Timer 1 register, TMR1L (0) or TMR1H (1).
+ *
+ * @param <unsigned char hi> the register
+ * @return <volatile unsigned char *> the register, valid until the next access
+ */
+volatile unsigned char *host_tmr1(unsigned char hi);
+
+/**
+ * host_adcon0bits()
+ *
+ * @brief This function gets the ADCON0 bits, a conversion started with GO
+ *        is done when it returns.
+ *
+ * @param <void> takes no arguments
+ * @return <HOST_ADCON0BITS_T *> the bits
+ */
+HOST_ADCON0BITS_T *host_adcon0bits(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,143 @@
+/****************************************************************************
+* Title                 :   Temperature Logger Decoder
+* Filename              :   log_decode.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with:
+*                           cc -I.. -o log_decode log_decode.c ../crc.c
+*******************************************************************************/
+/** \file   log_decode.c
+ *  \brief  This file converts a binary dump of the external EEPROM (starting
+ *          at address 0x0000) to a CSV of the temperature logger records,
+ *          oldest first.
+ *
+ *  usage: log_decode <eeprom.bin> [interval_s] > log.csv
+ *  time_s counts LOG_INTERVAL per record, the power_on / power_off events
+ *  mark the gaps while the unit was off.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "crc.h"
+#include "logger.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define DUMP_SIZE                           STORAGE_SIZE
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * find_head()
+ * Same search as logger_init(): the newest page is the last one followed
+ * by its sequence number plus one.
+-*------------------------------------------------------------------*/
+static unsigned find_head(const unsigned char *dump)
+{
+    unsigned page;
+    unsigned char seq = dump[LOG_PAGE_ADDRESS(0)];
+
+    for(page = 1 ; page < LOG_PAGES ; page++)
+    {
+        if(dump[LOG_PAGE_ADDRESS(page)] != (unsigned char)(seq + 1))
+        {
+            break;
+        }
+        seq = dump[LOG_PAGE_ADDRESS(page)];
+    }
+    return page - 1;
+}
+
+/*------------------------------------------------------------------*
+ * print_events()
+ * Prints the event flags of a record separated by '|'.
+-*------------------------------------------------------------------*/
+static void print_events(unsigned char ev)
+{
+    const char *sep = "";
+
+    if(ev & LOG_EV_POWER_ON)  { printf("%spower_on", sep);  sep = "|"; }
+    if(ev & LOG_EV_POWER_OFF) { printf("%spower_off", sep); sep = "|"; }
+    if(ev & LOG_EV_SETPOINT)  { printf("%ssetpoint", sep);  sep = "|"; }
+    if(ev & LOG_EV_WDT_RESET) { printf("%swdt_reset", sep); sep = "|"; }
+    if(ev & LOG_EV_CALIBRATION) { printf("%scalibration", sep); sep = "|"; }
+    if(ev & LOG_EV_POWER_FAIL) { printf("%spower_fail", sep); sep = "|"; }
+    if(ev & ~(LOG_EV_POWER_ON | LOG_EV_POWER_OFF | LOG_EV_SETPOINT | LOG_EV_WDT_RESET | LOG_EV_CALIBRATION | LOG_EV_POWER_FAIL) & LOG_EV_MSK)
+    {
+        printf("%s0x%02X", sep, ev);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char dump[DUMP_SIZE];
+    unsigned long interval = LOG_INTERVAL;
+    unsigned long sample = 0;
+    unsigned head, n, page, rec;
+    FILE *fp;
+    size_t len;
+
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <eeprom.bin> [interval_s]\n", argv[0]);
+        return 1;
+    }
+    if(argc > 2)
+    {
+        interval = strtoul(argv[2], NULL, 0);
+    }
+    fp = fopen(argv[1], "rb");
+    if(fp == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    len = fread(dump, 1, sizeof(dump), fp);
+    fclose(fp);
+    if(len < LOG_PAGE_ADDRESS(LOG_PAGES))
+    {
+        fprintf(stderr, "%s: dump too short (%u bytes)\n", argv[1], (unsigned)len);
+        return 1;
+    }
+
+    head = find_head(dump);
+    printf("sample,time_s,page_seq,avg_temp,set_temp,heater,cooler,events\n");
+    for(n = 1 ; n <= LOG_PAGES ; n++)
+    {
+        const unsigned char *p;
+        int temp;
+
+        page = (head + n) % LOG_PAGES;                  // oldest page first
+        p = &dump[LOG_PAGE_ADDRESS(page)];
+        if(crc8(p, LOG_CRC_BYTE) != p[LOG_CRC_BYTE])
+        {
+            continue;                                   // blank or torn page
+        }
+        temp = p[LOG_TEMP_BYTE];
+        for(rec = 0 ; rec < LOG_RECS_PER_PAGE ; rec++)
+        {
+            const unsigned char *r = &p[LOG_HDR_SIZE + (rec * LOG_REC_SIZE)];
+            unsigned char state = r[1] >> LOG_STATE_SHIFT;
+
+            if(r[1] == LOG_REC_EMPTY)
+            {
+                break;
+            }
+            temp += (signed char)r[0];
+            printf("%lu,%lu,%u,%d,%u,%u,%u,", sample, sample * interval, p[LOG_SEQ_BYTE],
+                   temp, p[LOG_DTEMP_BYTE], state == LOG_STATE_HEATER, state == LOG_STATE_COOLER);
+            print_events(r[1] & LOG_EV_MSK);
+            printf("\n");
+            sample++;
+        }
+    }
+    return 0;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,172 @@
+/****************************************************************************
+* Title                 :   Modbus Master Test
+* Filename              :   mb_master.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with:
+*                           cc -I.. -o mb_master mb_master.c ../crc.c
+*******************************************************************************/
+/** \file   mb_master.c
+ *  \brief  This file polls the Modbus slave over a serial device or a pty,
+ *          checks every reply and reports the response latency.
+ *
+ *  usage: mb_master <device> [count] [address]
+ *  Every poll reads the first MODBUS_MAX_REGS input registers and the set
+ *  temperature, the latency is from the last request byte written to the
+ *  last reply byte read (so it includes both frames on the line, ~9ms at
+ *  19200 baud, plus the 3.5 character gap and the dispatcher delay).
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/select.h>
+#include "config_EW_Heater.h"
+#include "crc.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define REPLY_TIMEOUT_MS                    200
+#define POLL_GAP_MS                         20
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * now_us()
+ * Monotonic time in microseconds.
+-*------------------------------------------------------------------*/
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*------------------------------------------------------------------*
+ * open_port()
+ * Opens the device, a terminal is switched to raw 19200 8N1.
+-*------------------------------------------------------------------*/
+static int open_port(const char *name)
+{
+    struct termios tio;
+    int fd = open(name, O_RDWR | O_NOCTTY);
+
+    if(fd >= 0 && isatty(fd) && tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B19200);
+        cfsetospeed(&tio, B19200);
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIOFLUSH);
+    }
+    return fd;
+}
+
+/*------------------------------------------------------------------*
+ * transact()
+ * Sends a request (the CRC is appended) and reads a reply of (want)
+ * bytes, an exception reply is 5 bytes. Returns the reply length, 0 on
+ * a timeout and -1 on a CRC error.
+-*------------------------------------------------------------------*/
+static int transact(int fd, unsigned char *req, int len, unsigned char *rep, int want, double *lat)
+{
+    unsigned int crc = crc16(req, len);
+    struct timeval tv;
+    fd_set set;
+    double t0;
+    int got = 0;
+
+    req[len] = (unsigned char)crc;
+    req[len + 1] = (unsigned char)(crc >> 8);
+    if(write(fd, req, len + 2) != len + 2)
+    {
+        return 0;
+    }
+    tcdrain(fd);
+    t0 = now_us();
+    while(got < want && !(got == 5 && (rep[1] & 0x80)))
+    {
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+        tv.tv_sec = 0;
+        tv.tv_usec = REPLY_TIMEOUT_MS * 1000;
+        if(select(fd + 1, &set, NULL, NULL, &tv) <= 0 || read(fd, &rep[got], 1) != 1)
+        {
+            return 0;
+        }
+        got++;
+    }
+    *lat = now_us() - t0;
+    crc = crc16(rep, got - 2);
+    if(rep[got - 2] != (unsigned char)crc || rep[got - 1] != (unsigned char)(crc >> 8))
+    {
+        return -1;
+    }
+    return got;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char req[16], rep[64];
+    int count = (argc > 2) ? atoi(argv[2]) : 100;
+    int addr = (argc > 3) ? atoi(argv[3]) : MODBUS_ADDRESS;
+    int fd, n, i, ok = 0, lost = 0, bad = 0;
+    double lat, lmin = 1e12, lmax = 0, lsum = 0;
+
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <device> [count] [address]\n", argv[0]);
+        return 1;
+    }
+    fd = open_port(argv[1]);
+    if(fd < 0)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    for(i = 0 ; i < count ; i++)
+    {
+        /* odd polls read the set temperature, even polls the input registers */
+        req[0] = addr;
+        req[1] = (i & 1) ? 0x03 : 0x04;
+        req[2] = 0;
+        req[3] = 0;
+        req[4] = 0;
+        req[5] = (i & 1) ? 1 : MODBUS_MAX_REGS;
+        n = transact(fd, req, 6, rep, 5 + 2 * req[5], &lat);
+        if(n == 0)
+        {
+            lost++;
+        }
+        else if(n < 0 || (rep[1] & 0x80))
+        {
+            bad++;
+        }
+        else
+        {
+            ok++;
+            lsum += lat;
+            lmin = (lat < lmin) ? lat : lmin;
+            lmax = (lat > lmax) ? lat : lmax;
+        }
+        usleep(POLL_GAP_MS * 1000);
+    }
+    printf("polls %d ok %d timeout %d error %d\n", count, ok, lost, bad);
+    if(ok)
+    {
+        printf("latency us min %.0f avg %.0f max %.0f\n", lmin, lsum / ok, lmax);
+    }
+    return (ok == count) ? 0 : 2;
+}
+/*** End of File **************************************************************/
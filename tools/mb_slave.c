@@ -0,0 +1,152 @@
+/****************************************************************************
+* Title                 :   Modbus Slave on a pty
+* Filename              :   mb_slave.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with: make mb_slave (see Makefile)
+*******************************************************************************/
+/** \file   mb_slave.c
+ *  \brief  This file runs the Modbus build of the firmware on the host in
+ *          real time with its USART on a pseudo terminal, so tools/mb_master
+ *          can poll the real slave and register callbacks.
+ *
+ *  usage: mb_slave [seconds] 2> slave.log &
+ *         mb_master $(sed -n 's/^pty //p' slave.log) 100
+ *
+ *  - The pty name is printed on stderr as "pty <name>" before the
+ *    firmware starts, the slave runs for (seconds), 10 by default.
+ *  - Timer 1 follows the host clock, so the 3.5 character gap of the
+ *    frames is the one of the firmware (CCP1 compare on Timer 1).
+ *  - Every byte from the master is one USART receive interrupt, every byte
+ *    the firmware puts in TXREG is written to the pty.
+ *  - The sensor reads a constant INITIAL_TEMP, the storage starts erased
+ *    (STORAGE_FILE_NAME in the current directory).
+ *  - A pty has no baud rate, the latency mb_master reports is the 3.5
+ *    character gap, the dispatcher delay and the host loop (SLAVE_POLL_US)
+ *    without the frames on the line (about 1.8ms - 2.8ms here for the
+ *    100 polls of mb_master).
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "config_EW_Heater.h"
+#include "host.h"
+#include "tstamp.h"
+#include "sch.h"
+#include "EW_Heater.h"
+
+#if SERIAL_PROTOCOL != SERIAL_PROTOCOL_MODBUS
+#error "build mb_slave with -DSERIAL_PROTOCOL=1 (SERIAL_PROTOCOL_MODBUS)"
+#endif
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define SLAVE_POLL_US                       100     // host loop period
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+void ISR(void);
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * open_pty()
+ * Opens a raw pseudo terminal, returns the master side.
+-*------------------------------------------------------------------*/
+static int open_pty(void)
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if(fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        return -1;
+    }
+    if(tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    unsigned long long now, next_tick;
+    unsigned int t35;
+    unsigned char c;
+    int fd, tx;
+
+    if(argc > 2 || seconds <= 0)
+    {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 2;
+    }
+    fd = open_pty();
+    if(fd < 0)
+    {
+        perror("pty");
+        return 1;
+    }
+    fprintf(stderr, "pty %s\n", ptsname(fd));
+    if(host_storage_load(NULL) != 0)
+    {
+        perror(STORAGE_FILE_NAME);
+        return 1;
+    }
+    host_clock = HOST_CLOCK_REAL;
+
+    /* main.c, with the dispatcher run on the host clock */
+    host_boot();
+    next_tick = host_now_us() + SCH_TICK * 1000ULL;
+    for(now = host_now_us() ; now < (unsigned long long)(seconds * 1e6) ; now = host_now_us())
+    {
+        while(read(fd, &c, 1) == 1)
+        {
+            RCREG = c;
+            RCIF = 1;
+            ISR();
+            RCIF = 0;
+        }
+        t35 = ((unsigned int)CCPR1H << 8) | CCPR1L;
+        if(CCP1IE && (short)(tstamp_get() - t35) >= 0)
+        {
+            CCP1IF = 1;
+            ISR();
+        }
+        if(now >= next_tick)
+        {
+            next_tick += SCH_TICK * 1000ULL;
+            host_tick();
+        }
+        SCH_Dispatch_Tasks();
+        while((tx = host_tx()) >= 0)
+        {
+            c = (unsigned char)tx;
+            if(write(fd, &c, 1) != 1)
+            {
+                break;
+            }
+        }
+        usleep(SLAVE_POLL_US);
+    }
+    close(fd);
+    return 0;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,418 @@
+/****************************************************************************
+* Title                 :   Input Replay
+* Filename              :   replay.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with the configuration of the recording unit:
+*                           make replay HOST_FLAGS=-DSERIAL_PROTOCOL=2 (see Makefile)
+*******************************************************************************/
+/** \file   replay.c
+ *  \brief  This file runs the firmware on the host against the inputs
+ *          recorded by a unit built with SERIAL_PROTOCOL_RECORD and prints
+ *          the outputs it drives, so a field capture becomes a regression
+ *          test of the task set.
+ *
+ *  usage: replay [-t trace.bin] <capture.bin> [eeprom.bin] > trace.csv
+ *         diff golden.csv trace.csv
+ *  tools/replay_check.sh does this for the captures in tools/captures.
+ *
+ *  - capture.bin is the raw USART stream of the recording unit, from its
+ *    reset on. eeprom.bin is the storage image the unit started with
+ *    (erased if missing), it holds the settings and the logger state. It
+ *    is copied to STORAGE_FILE_NAME in the current directory, which holds
+ *    the storage the replay left at the end.
+ *  - The ADC returns the recorded results in order, the switch port
+ *    inputs (TRISB bits) are set before every tick and the recorded wake
+ *    ups end the SLEEP of pwr_off(). Each tick runs the Timer 0 branch of
+ *    ISR() and one SCH_Dispatch_Tasks() pass, so the tasks always fit in
+ *    their tick: a capture with overruns replays without them.
+ *  - The trace has a line per change of the heater, cooler, heat LED and
+ *    display frame buffer (also checked before every sleep), per storage
+ *    write and per sleep / wake up.
+ *  - Every difference between the recording and the replayed firmware
+ *    (an ADC read of another channel or tick, a recorded output pin that
+ *    differs) is counted, the exit code is 1 if the replay diverged.
+ *  - -t writes the event trace of a TRACE_ENABLE build, the ring is dumped
+ *    after every dispatcher pass (tools/trace2chrome converts the file).
+ *    Timer 1 moves SCH_TICK per tick, the events of a tick share a time.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "config_EW_Heater.h"
+#include "host.h"
+#include "port.h"
+#include "record.h"
+#include "storage.h"
+#include "trace.h"
+#include "heater.h"
+#include "cooler.h"
+#include "ssd.h"
+#include "sch.h"
+#include "EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define REPLAY_MAX_IDLE                     1000    // dispatcher passes without a tick
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef struct
+{
+    unsigned char kind;
+    unsigned char ch;
+    unsigned long tick;
+    unsigned int val;
+} REC_T;
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static unsigned char *cap;              // capture file
+static long cap_len, cap_pos;
+static unsigned long cap_tick;          // tick of the last record taken
+static unsigned long tick;              // ticks run by the replay
+static unsigned int adc_last[16];
+static unsigned long div_adc, div_time, div_pin, div_sleep, lost, resync;
+static clock_t t_start;
+static FILE *trace_fp;                  // -t
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * rec_peek()
+ * Decodes the next record without taking it, bytes that do not start a
+ * record are skipped. Returns 0 at the end of the capture.
+-*------------------------------------------------------------------*/
+static int rec_peek(REC_T *r)
+{
+    const unsigned char *p;
+
+    while(cap_pos + REC_SIZE <= cap_len)
+    {
+        p = &cap[cap_pos];
+        if((p[0] & REC_SYNC) && !((p[1] | p[2] | p[3]) & REC_SYNC))
+        {
+            r->kind = (p[0] >> 4) & 0x07;
+            r->ch = p[0] & 0x0F;
+            r->tick = cap_tick + p[1];
+            r->val = ((unsigned int)p[2] << 7) | p[3];
+            return 1;
+        }
+        cap_pos++;
+        resync++;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------------*
+ * rec_take()
+ * Takes the record returned by rec_peek().
+-*------------------------------------------------------------------*/
+static void rec_take(const REC_T *r)
+{
+    cap_tick = r->tick;
+    cap_pos += REC_SIZE;
+    if(r->kind == REC_KIND_LOST)
+    {
+        lost += r->val;
+        fprintf(stderr, "tick %lu: %u record(s) lost in the capture\n", tick, r->val);
+    }
+}
+
+/*------------------------------------------------------------------*
+ * dump_put() / dump_trace()
+ * Empties the event trace ring into the -t file.
+-*------------------------------------------------------------------*/
+#if TRACE_ENABLE
+static void dump_put(unsigned char c)
+{
+    fputc(c, trace_fp);
+}
+#endif
+
+static void dump_trace(void)
+{
+#if TRACE_ENABLE
+    if(trace_fp != NULL)
+    {
+        trace_dump(dump_put);
+    }
+#endif
+}
+
+/*------------------------------------------------------------------*
+ * finish()
+ * Prints the summary and leaves, also called from inside the firmware
+ * when the capture ends during a sleep.
+-*------------------------------------------------------------------*/
+static void finish(void)
+{
+    double host_s = (double)(clock() - t_start) / CLOCKS_PER_SEC;
+    double sim_s = tick * (SCH_TICK / 1000.0);
+    unsigned long div = div_adc + div_time + div_pin + div_sleep;
+
+    fprintf(stderr, "%lu ticks (%.1f s) replayed in %.3f s", tick, sim_s, host_s);
+    if(host_s > 0)
+    {
+        fprintf(stderr, ", %.0fx real time", sim_s / host_s);
+    }
+    fprintf(stderr, "\ndiverged: adc %lu, adc tick %lu, pins %lu, sleep %lu; lost %lu; resync %lu\n",
+            div_adc, div_time, div_pin, div_sleep, lost, resync);
+    if(trace_fp != NULL)
+    {
+        dump_trace();
+        fclose(trace_fp);
+    }
+    exit((div || lost) ? 1 : 0);
+}
+
+/*------------------------------------------------------------------*
+ * apply_inputs()
+ * Takes the asynchronous records up to the current tick before its
+ * Timer 0 interrupt. An ADC or wake up record of an earlier tick still
+ * pending here was not seen by the replayed firmware, the ones of this
+ * tick are left to its dispatcher pass.
+-*------------------------------------------------------------------*/
+static void apply_inputs(void)
+{
+    REC_T r;
+
+    while(rec_peek(&r) && r.tick <= tick)
+    {
+        if(r.kind == REC_KIND_PORTB)
+        {
+            if((r.val ^ PORTB) & ~TRISB & 0xFF)
+            {
+                div_pin++;          // an output of the switch port differs
+            }
+            PORTB = (PORTB & ~TRISB) | (r.val & TRISB);
+        }
+        else if((r.kind == REC_KIND_ADC || r.kind == REC_KIND_INT) && r.tick == tick)
+        {
+            break;                  // read by the tasks of this tick, or they sleep
+        }
+        else if(r.kind == REC_KIND_ADC || r.kind == REC_KIND_INT)
+        {
+            if(r.kind == REC_KIND_ADC)
+            {
+                div_adc++;
+            }
+            else
+            {
+                div_sleep++;        // the recorded unit slept, the replay did not
+            }
+        }
+        rec_take(&r);
+    }
+}
+
+/*------------------------------------------------------------------*
+ * print_outputs()
+ * Prints the outputs when one of them changed.
+-*------------------------------------------------------------------*/
+static void print_outputs(void)
+{
+    static unsigned char last[3 + SSD_NUM];
+    static int first = 1;
+    unsigned char now[3 + SSD_NUM];
+    unsigned char i;
+
+    now[0] = heater_is_on() != 0;
+    now[1] = cooler_is_on() != 0;
+    now[2] = (HEAT_LED_PORT & HEAT_LED_MSK) != 0;
+    for(i = 0 ; i < SSD_NUM ; i++)
+    {
+        now[3 + i] = ssd_fb_read(i);
+    }
+    if(first || memcmp(now, last, sizeof(now)))
+    {
+        printf("%lu,out,%u,%u,%u", tick, now[0], now[1], now[2]);
+        for(i = 0 ; i < SSD_NUM ; i++)
+        {
+            printf(",%02X", now[3 + i]);
+        }
+        printf("\n");
+        memcpy(last, now, sizeof(now));
+        first = 0;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * replay_sleep()
+ * SLEEP waits for the next recorded wake up and runs its interrupt.
+-*------------------------------------------------------------------*/
+static void replay_sleep(void)
+{
+    REC_T r;
+
+    print_outputs();                // the outputs the power off left
+    printf("%lu,sleep\n", tick);
+    while(rec_peek(&r))
+    {
+        rec_take(&r);
+        if(r.kind == REC_KIND_INT)
+        {
+            printf("%lu,wake\n", tick);
+            host_wake();
+            return;
+        }
+        if(r.kind != REC_KIND_SKIP && r.kind != REC_KIND_LOST)
+        {
+            div_sleep++;            // the replay slept, the recorded unit did not
+        }
+    }
+    finish();
+}
+
+/*------------------------------------------------------------------*
+ * replay_adc()
+ * The recorded results are returned in order.
+-*------------------------------------------------------------------*/
+static unsigned int replay_adc(unsigned char canal)
+{
+    REC_T r;
+
+    while(rec_peek(&r) && (r.kind == REC_KIND_SKIP || r.kind == REC_KIND_LOST) && r.tick <= tick)
+    {
+        rec_take(&r);
+    }
+    if(!rec_peek(&r) || r.kind != REC_KIND_ADC || r.ch != canal)
+    {
+        div_adc++;
+        return adc_last[canal & 0x0F];
+    }
+    if(r.tick != tick)
+    {
+        div_time++;
+    }
+    rec_take(&r);
+    adc_last[canal & 0x0F] = r.val;
+    return r.val;
+}
+
+/*------------------------------------------------------------------*
+ * trace_write()
+ * Traces a storage write.
+-*------------------------------------------------------------------*/
+static void trace_write(unsigned int addr, const unsigned char *buf, unsigned char len)
+{
+    unsigned char i;
+
+    printf("%lu,eeprom,%04X,", tick, addr);
+    for(i = 0 ; i < len ; i++)
+    {
+        printf("%02X", buf[i]);
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------------*
+ * load()
+ * Reads a whole file, returns its size or -1.
+-*------------------------------------------------------------------*/
+static long load(const char *name, unsigned char **buf)
+{
+    FILE *fp = fopen(name, "rb");
+    long len;
+
+    if(fp == NULL)
+    {
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    rewind(fp);
+    *buf = malloc(len + 1);
+    if(*buf == NULL || fread(*buf, 1, len, fp) != (size_t)len)
+    {
+        len = -1;
+    }
+    fclose(fp);
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    const char *image;
+    unsigned int idle;
+    REC_T r;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:")) == 't')
+    {
+        if(!TRACE_ENABLE)
+        {
+            fprintf(stderr, "%s: -t needs a build with TRACE_ENABLE=1\n", argv[0]);
+            return 2;
+        }
+        trace_fp = fopen(optarg, "wb");
+        if(trace_fp == NULL)
+        {
+            perror(optarg);
+            return 2;
+        }
+    }
+    if(opt != -1 || argc - optind < 1 || argc - optind > 2)
+    {
+        fprintf(stderr, "usage: %s [-t trace.bin] <capture.bin> [eeprom.bin]\n", argv[0]);
+        return 2;
+    }
+    cap_len = load(argv[optind], &cap);
+    if(cap_len < 0)
+    {
+        perror(argv[optind]);
+        return 2;
+    }
+    image = (argc - optind == 2) ? argv[optind + 1] : NULL;
+    if(host_storage_load(image) != 0)
+    {
+        perror((image != NULL) ? image : STORAGE_FILE_NAME);
+        return 2;
+    }
+    host_adc = replay_adc;
+    host_sleep = replay_sleep;
+    storage_file_hook = trace_write;
+    t_start = clock();
+
+    /* main.c, with one dispatcher pass per tick */
+    host_boot();
+    for(idle = 0 ; idle < REPLAY_MAX_IDLE && rec_peek(&r) ; )
+    {
+        /* the recorded tick only counts while Timer 0 runs */
+        if(TMR0IE)
+        {
+            tick++;
+            apply_inputs();
+            host_tick();
+            idle = 0;
+        }
+        else
+        {
+            idle++;
+        }
+        SCH_Dispatch_Tasks();
+        print_outputs();
+        dump_trace();
+    }
+    if(idle == REPLAY_MAX_IDLE)
+    {
+        fprintf(stderr, "tick %lu: the scheduler stopped without sleeping\n", tick);
+        div_sleep++;
+    }
+    finish();
+    return 0;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,132 @@
+#!/bin/sh
+#****************************************************************************
+# Title                 :   Replay Regression Check
+# Filename              :   replay_check.sh
+# Author                :   Muhammed Elkomy
+# Origin Date           :   08/07/2020
+# Version               :   1.0.0
+#
+# Notes                 :   Host tool, run from tools/: ./replay_check.sh [-u | -r] [cc flags]
+#*****************************************************************************
+# Builds tools/replay like the recording unit (SERIAL_PROTOCOL_RECORD) and
+# replays every capture in captures/ (<name>.bin, with <name>.eep as the
+# starting storage image when present). The replay must not diverge from
+# the capture at all and its trace must match <name>.csv, -u writes the
+# new <name>.csv instead (review the diff before committing it).
+#
+# The captures are recorded from the firmware by the RECORD build of
+# tank_sim (tools/host), -r records them again and updates the .csv:
+#   - reload.eep is the storage left by MINUS pressed three times (set
+#     temperature 50).
+#   - basic.bin: PLUS three times and MINUS from tick 1000 (set temperature
+#     65), ON/OFF at tick 4000, the unit is switched on again at once.
+#     reload.bin is the same run started from reload.eep.
+#   - supply_drop.bin: PLUS three times from tick 2000 (set temperature 70)
+#     and the mains dropped at tick 2600, before the deferred save.
+# Besides its .csv the power fail handler is checked directly: after the
+# drop the heater and cooler are off at the sleep, the settings page is
+# written once with the set temperature 70 and the logger page once.
+# basic.bin is also replayed by a TRACE_ENABLE build, the dump of replay -t
+# must convert with trace2chrome (and parse as JSON when python3 is there).
+
+update=0
+record=0
+if [ "$1" = "-u" ]; then
+    update=1
+    shift
+elif [ "$1" = "-r" ]; then
+    update=1
+    record=1
+    shift
+fi
+cd "$(dirname "$0")" || exit 2
+out=${TMPDIR:-/tmp}/replay_check.$$
+trap 'rm -rf "$out"' EXIT
+mkdir -p "$out"
+
+flags="-DSERIAL_PROTOCOL=SERIAL_PROTOCOL_RECORD $*"
+make -s OUT="$out" HOST_FLAGS="$flags" "$out/replay" "$out/tank_sim" 2> "$out/build.txt" || {
+    cat "$out/build.txt"
+    exit 2
+}
+
+# the storage files of the tools are left in $out
+replay() {
+    (cd "$out" && ./replay "$@")
+}
+tank_sim() {
+    (cd "$out" && ./tank_sim "$@" > /dev/null)
+}
+
+if [ $record -eq 1 ]; then
+    keys="-k 1000:plus -k 1100:plus -k 1200:plus -k 1300:minus -k 4000:power"
+    tank_sim -k 200:minus -k 300:minus -k 400:minus 10s &&
+        cp "$out/eeprom.bin" captures/reload.eep &&
+        tank_sim -u "$PWD/captures/basic.bin" $keys 30s &&
+        tank_sim -u "$PWD/captures/reload.bin" -e "$PWD/captures/reload.eep" $keys 30s &&
+        tank_sim -u "$PWD/captures/supply_drop.bin" -k 2000:plus -k 2100:plus -k 2200:plus -d 2600 30s ||
+        exit 2
+    echo "recorded captures/basic.bin reload.bin reload.eep supply_drop.bin"
+fi
+
+fail=0
+for cap in captures/*.bin; do
+    name=${cap%.bin}
+    eep=
+    [ -f "$name.eep" ] && eep=$PWD/$name.eep
+    replay "$PWD/$cap" $eep > "$out/trace.csv" 2> "$out/summary.txt"
+    grep '^diverged:' "$out/summary.txt" >> "$out/trace.csv"
+    # every count of the summary must be 0
+    if ! awk '/^diverged:/ { n++; gsub(/[^0-9 ]/, ""); for(i = 1 ; i <= NF ; i++) if($i != 0) bad++ }
+              END { exit !(n == 1 && bad == 0) }' "$out/summary.txt"; then
+        cat "$out/summary.txt"
+        echo "FAIL $cap: the replay diverged"
+        fail=1
+    elif [ $update -eq 1 ]; then
+        cp "$out/trace.csv" "$name.csv"
+        echo "updated $name.csv"
+    elif diff "$name.csv" "$out/trace.csv"; then
+        echo "ok   $cap"
+    else
+        echo "FAIL $cap"
+        fail=1
+    fi
+done
+
+# supply_drop: what pwr_fail() persists
+if [ $update -eq 0 ] && [ -f captures/supply_drop.bin ]; then
+    replay "$PWD/captures/supply_drop.bin" > "$out/trace.csv" 2> /dev/null
+    if awk -F, '
+        $1 >= 2600 && $2 == "eeprom" && $3 >= "0180" && $3 < "0200" { set++; dtemp = substr($4, 3, 4) }
+        $1 >= 2600 && $2 == "eeprom" && $3 >= "0010" && $3 < "0180" { logs++ }
+        $1 >= 2600 && $2 == "out" { heat = $3; cool = $4 }
+        END { exit !(set == 1 && dtemp == "4600" && logs == 1 && heat == 0 && cool == 0) }
+        ' "$out/trace.csv"; then
+        echo "ok   power fail: settings and logger page once each, outputs off"
+    else
+        echo "FAIL power fail: see the eeprom and out lines after tick 2600"
+        fail=1
+    fi
+fi
+
+# event trace: basic.bin replayed by a TRACE_ENABLE build with -t, the same
+# trace is expected and trace2chrome must turn the dump into valid JSON
+if [ $update -eq 0 ] && [ -f captures/basic.bin ]; then
+    mkdir -p "$out/trace"
+    make -s OUT="$out/trace" HOST_FLAGS="$flags -DTRACE_ENABLE=1" \
+         "$out/trace/replay" "$out/trace/trace2chrome" 2> "$out/build.txt" || {
+        cat "$out/build.txt"
+        exit 2
+    }
+    cap=$PWD/captures/basic.bin
+    if (cd "$out/trace" && ./replay -t trace.bin "$cap" > trace.csv 2> /dev/null &&
+        ./trace2chrome trace.bin > trace.json) &&
+       grep -v '^diverged:' captures/basic.csv | diff -q - "$out/trace/trace.csv" > /dev/null &&
+       { ! command -v python3 > /dev/null || python3 -m json.tool "$out/trace/trace.json" > /dev/null; }; then
+        echo "ok   event trace: $(grep -c '"ph"' "$out/trace/trace.json") events converted"
+    else
+        echo "FAIL event trace: the TRACE_ENABLE replay or its conversion"
+        fail=1
+    fi
+fi
+exit $fail
@@ -0,0 +1,397 @@
+/****************************************************************************
+* Title                 :   Tank Simulation
+* Filename              :   tank_sim.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with: make tank_sim (see Makefile)
+*                           add HOST_FLAGS=-DTEMP_DEADBAND=0 for the heater / cooler cycle,
+*                           HOST_FLAGS=-DTEMP_ADAPT_ENABLE=0 for a fixed sense / control rate
+*******************************************************************************/
+/** \file   tank_sim.c
+ *  \brief  This file runs the firmware on the host against a model of the
+ *          tank, so control changes can be compared on energy and relay
+ *          wear before they reach a unit.
+ *
+ *  usage: tank_sim [-m] [-u usart.bin] [-e eeprom.bin] [-k tick:key[:ticks]]...
+ *                  [-d tick] [hours | <seconds>s] > summary.csv
+ *
+ *  - The tank is one mixed volume of water (SIM_LITRES) losing heat to the
+ *    room, the heater adds HEATER_POWER_W, the cooler removes SIM_COOL_W.
+ *    Hot water draws (sim_draws) are replaced by cold inlet water.
+ *  - The sensor follows the water with a first order lag and +-1 count of
+ *    noise, it starts at the set temperature so the first hour is not a
+ *    warm up.
+ *  - Each tick runs the Timer 0 branch of ISR() and one
+ *    SCH_Dispatch_Tasks() pass like tools/replay. The storage starts
+ *    erased (STORAGE_FILE_NAME in the current directory).
+ *  - The summary has the energy of each element, the relay operations,
+ *    the sensor conversions and the tank temperature range. -m adds a line
+ *    per minute.
+ *  - -u writes what the USART sends to a file at the line rate (19200
+ *    baud), with SERIAL_PROTOCOL_RECORD it is a capture for tools/replay.
+ *    -e starts the storage from an image, -k presses plus, minus or power
+ *    at a tick for (ticks), 20 by default. -d drops the mains at a tick:
+ *    the supply reading falls to 0 in SIM_DROP_TICKS and the run ends at
+ *    the sleep of the power fail handler.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <xc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "config_EW_Heater.h"
+#include "host.h"
+#include "port.h"
+#include "heater.h"
+#include "cooler.h"
+#include "energy.h"
+#include "sch.h"
+#include "EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define SIM_LITRES                          80.0
+#define SIM_HEAT_CAP                        (SIM_LITRES * 4186.0)  // J/K
+#define SIM_LOSS_W_PER_K                    1.5
+#define SIM_AMBIENT                         20.0
+#define SIM_INLET                           15.0
+#define SIM_COOL_W                          300.0   // heat removed by the cooler
+#define SIM_DRAW_L_PER_S                    0.1
+#define SIM_SENSOR_TAU                      20.0    // seconds
+#define SIM_DT                              (SCH_TICK / 1000.0)
+#define SIM_TICKS_PER_MIN                   (60000UL / SCH_TICK)
+#define SIM_TX_PER_TICK                     (8000000UL / (16UL * (USART_SPBRG + 1)) / 10 * SCH_TICK / 1000)
+#define SIM_MAX_KEYS                        16
+#define SIM_PRESS_TICKS                     20
+#define SIM_DROP_TICKS                      40      // hold-up capacitor discharge
+
+/******************************************************************************
+* Typedefs
+*******************************************************************************/
+typedef struct
+{
+    double hour;
+    double litres;
+} SIM_DRAW_T;
+
+typedef struct
+{
+    unsigned long tick;
+    unsigned long ticks;
+    unsigned char msk;
+} SIM_KEY_T;
+
+typedef struct
+{
+    const char *name;
+    unsigned char msk;
+} SIM_KEY_NAME_T;
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static const SIM_DRAW_T sim_draws[] = {
+    { 6.5, 30.0 }, { 7.0, 20.0 }, { 12.5, 10.0 }, { 19.0, 40.0 }, { 21.5, 20.0 }
+};
+static const SIM_KEY_NAME_T sim_key_names[] = {
+    { "plus", PLUS_SW_MSK }, { "minus", MINUS_SW_MSK }, { "power", PWR_SW_MSK }
+};
+static double tank = INITIAL_TEMP;
+static double sensor = INITIAL_TEMP;
+static unsigned long tick;
+static unsigned long noise = 1;
+static unsigned long samples;
+static SIM_KEY_T sim_keys[SIM_MAX_KEYS];
+static unsigned char sim_nkeys;
+static unsigned long drop_tick;         // mains drop, 0 if none
+static FILE *usart_fp;
+
+/* summary */
+static double heater_ws, cooler_ws, sum, t_min = 1000, t_max = -1000;
+static unsigned long heater_starts, cooler_starts, relay_ops;
+static unsigned char heater, cooler;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * sim_step()
+ * Advances the tank and the sensor by one tick.
+-*------------------------------------------------------------------*/
+static void sim_step(void)
+{
+    double hour = tick * SIM_DT / 3600.0;
+    double watts = -SIM_LOSS_W_PER_K * (tank - SIM_AMBIENT);
+    unsigned int i;
+
+    hour -= (double)(unsigned long)(hour / 24.0) * 24.0;   // time of day
+    if(heater_is_on())
+    {
+        watts += HEATER_POWER_W;
+    }
+    if(cooler_is_on())
+    {
+        watts -= SIM_COOL_W;
+    }
+    tank += watts * SIM_DT / SIM_HEAT_CAP;
+    for(i = 0 ; i < sizeof(sim_draws) / sizeof(sim_draws[0]) ; i++)
+    {
+        if(hour >= sim_draws[i].hour &&
+           hour < sim_draws[i].hour + sim_draws[i].litres / SIM_DRAW_L_PER_S / 3600.0)
+        {
+            tank += (SIM_INLET - tank) * SIM_DRAW_L_PER_S * SIM_DT / SIM_LITRES;
+        }
+    }
+    sensor += (tank - sensor) * SIM_DT / SIM_SENSOR_TAU;
+}
+
+/*------------------------------------------------------------------*
+ * sim_adc()
+ * The sensor with +-1 count of noise, a nominal supply.
+-*------------------------------------------------------------------*/
+static unsigned int sim_adc(unsigned char canal)
+{
+    double counts;
+
+    if(canal == SUPPLY_SENSE_CH && drop_tick && tick >= drop_tick)
+    {
+        counts = HOST_SUPPLY_NOMINAL * (1.0 - (double)(tick - drop_tick) / SIM_DROP_TICKS);
+        return (counts > 0) ? (unsigned int)counts : 0;
+    }
+    if(canal != TEMP_SENSOR_CH)
+    {
+        return host_adc_nominal(canal);
+    }
+    samples++;
+    noise = noise * 1103515245UL + 12345UL;
+    counts = sensor * HOST_COUNTS_PER_C + (double)((noise >> 16) % 3) - 1.0;
+    return (counts > 0) ? (unsigned int)(counts + 0.5) : 0;
+}
+
+/*------------------------------------------------------------------*
+ * sim_keys_port()
+ * Sets the switch inputs of the current tick, a pressed switch reads 0.
+-*------------------------------------------------------------------*/
+static void sim_keys_port(void)
+{
+    unsigned char port = 0xFF;
+    unsigned char i;
+
+    for(i = 0 ; i < sim_nkeys ; i++)
+    {
+        if(tick >= sim_keys[i].tick && tick < sim_keys[i].tick + sim_keys[i].ticks)
+        {
+            port &= ~sim_keys[i].msk;
+        }
+    }
+    PORTB = (PORTB & ~TRISB) | (port & TRISB);
+}
+
+/*------------------------------------------------------------------*
+ * sim_tx()
+ * Takes up to (max) bytes from the USART, they go to the -u file.
+-*------------------------------------------------------------------*/
+static void sim_tx(unsigned long max)
+{
+    int c;
+
+    while(max-- && (c = host_tx()) >= 0)
+    {
+        if(usart_fp != NULL)
+        {
+            fputc(c, usart_fp);
+        }
+    }
+}
+
+/*------------------------------------------------------------------*
+ * sim_account()
+ * Adds the current tick to the summary.
+-*------------------------------------------------------------------*/
+static void sim_account(unsigned char minutes)
+{
+    if((heater_is_on() != 0) != heater)
+    {
+        heater = !heater;
+        heater_starts += heater;
+        relay_ops++;
+    }
+    if((cooler_is_on() != 0) != cooler)
+    {
+        cooler = !cooler;
+        cooler_starts += cooler;
+        relay_ops++;
+    }
+    heater_ws += heater * HEATER_POWER_W * SIM_DT;
+    cooler_ws += cooler * COOLER_POWER_W * SIM_DT;
+    sum += tank;
+    t_min = (tank < t_min) ? tank : t_min;
+    t_max = (tank > t_max) ? tank : t_max;
+    if(minutes && tick % SIM_TICKS_PER_MIN == 0)
+    {
+        printf("%lu,%.2f,%.2f,%u,%u\n", tick / SIM_TICKS_PER_MIN, tank, sensor, heater, cooler);
+    }
+}
+
+/*------------------------------------------------------------------*
+ * sim_end()
+ * Prints the summary of the ticks run and leaves, the bytes still
+ * queued in the USART are written to the -u file.
+-*------------------------------------------------------------------*/
+static void sim_end(void)
+{
+    double hours = tick * SIM_DT / 3600.0;
+
+    if(usart_fp != NULL)
+    {
+        sim_tx((unsigned long)-1);
+        fclose(usart_fp);
+    }
+    if(tick == 0)
+    {
+        exit(0);
+    }
+    printf("control,%s\n", TEMP_DEADBAND ? "deadband" : "cycle");
+    printf("rate,%s\n", TEMP_ADAPT_ENABLE ? "adaptive" : "fixed");
+    printf("hours,%.1f\n", hours);
+    printf("heater_kwh,%.2f\n", heater_ws / 3.6e6);
+    printf("cooler_kwh,%.2f\n", cooler_ws / 3.6e6);
+    printf("kwh_per_day,%.2f\n", (heater_ws + cooler_ws) / 3.6e6 * 24.0 / hours);
+    printf("meter_kwh,%.2f\n", energy_get_total() / 1000.0);
+    printf("heater_starts,%lu\n", heater_starts);
+    printf("cooler_starts,%lu\n", cooler_starts);
+    printf("relay_ops_per_day,%.0f\n", relay_ops * 24.0 / hours);
+    printf("samples_per_day,%.0f\n", samples * 24.0 / hours);
+    printf("tank_min,%.1f\ntank_max,%.1f\ntank_mean,%.1f\n", t_min, t_max, sum / tick);
+    exit(0);
+}
+
+/*------------------------------------------------------------------*
+ * sim_sleep()
+ * The power switch wakes the unit up at once, after a mains drop the
+ * run ends.
+-*------------------------------------------------------------------*/
+static void sim_sleep(void)
+{
+    if(drop_tick && tick >= drop_tick)
+    {
+        sim_end();
+    }
+    host_wake();
+}
+
+/*------------------------------------------------------------------*
+ * sim_key()
+ * Parses a -k argument, returns 0 if it is not valid.
+-*------------------------------------------------------------------*/
+static int sim_key(const char *arg)
+{
+    SIM_KEY_T *k = &sim_keys[sim_nkeys];
+    char name[8];
+    unsigned int i;
+
+    k->ticks = SIM_PRESS_TICKS;
+    if(sim_nkeys == SIM_MAX_KEYS || sscanf(arg, "%lu:%7[a-z]:%lu", &k->tick, name, &k->ticks) < 2)
+    {
+        return 0;
+    }
+    for(i = 0 ; i < sizeof(sim_key_names) / sizeof(sim_key_names[0]) ; i++)
+    {
+        if(strcmp(name, sim_key_names[i].name) == 0)
+        {
+            k->msk = sim_key_names[i].msk;
+            sim_nkeys++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *image = NULL;
+    double hours = 24.0;
+    unsigned long ticks;
+    unsigned char minutes = 0;
+    int opt, ok = 1;
+    size_t len;
+
+    while(ok && (opt = getopt(argc, argv, "mu:e:k:d:")) != -1)
+    {
+        if(opt == 'm')
+        {
+            minutes = 1;
+        }
+        else if(opt == 'u')
+        {
+            usart_fp = fopen(optarg, "wb");
+            if(usart_fp == NULL)
+            {
+                perror(optarg);
+                return 2;
+            }
+        }
+        else if(opt == 'e')
+        {
+            image = optarg;
+        }
+        else if(opt == 'k')
+        {
+            ok = sim_key(optarg);
+        }
+        else if(opt == 'd' && atol(optarg) > 0)
+        {
+            drop_tick = atol(optarg);
+        }
+        else
+        {
+            ok = 0;
+        }
+    }
+    if(ok && optind == argc - 1 && atof(argv[optind]) > 0)
+    {
+        len = strlen(argv[optind]);
+        hours = atof(argv[optind]) / ((argv[optind][len - 1] == 's') ? 3600.0 : 1.0);
+    }
+    else if(!ok || optind != argc)
+    {
+        fprintf(stderr, "usage: %s [-m] [-u usart.bin] [-e eeprom.bin] [-k tick:plus|minus|power[:ticks]]...\n"
+                        "       [-d tick] [hours | <seconds>s]\n", argv[0]);
+        return 2;
+    }
+    ticks = (unsigned long)(hours * 3600.0 / SIM_DT + 0.5);
+    if(host_storage_load(image) != 0)
+    {
+        perror((image != NULL) ? image : STORAGE_FILE_NAME);
+        return 2;
+    }
+    host_adc = sim_adc;
+    host_sleep = sim_sleep;
+
+    /* main.c, with one dispatcher pass per tick */
+    host_boot();
+    if(minutes)
+    {
+        printf("minute,tank,sensor,heater,cooler\n");
+    }
+    for(tick = 1 ; tick <= ticks ; tick++)
+    {
+        sim_tx(SIM_TX_PER_TICK);            // sent during the previous tick
+        sim_keys_port();
+        sim_step();
+        host_tick();
+        SCH_Dispatch_Tasks();
+        sim_account(minutes);
+    }
+    tick = ticks;
+    sim_end();
+    return 0;
+}
+/*** End of File **************************************************************/
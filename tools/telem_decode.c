@@ -0,0 +1,147 @@
+/****************************************************************************
+* Title                 :   Telemetry Decoder
+* Filename              :   telem_decode.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with:
+*                           cc -I.. -o telem_decode telem_decode.c ../crc.c
+*******************************************************************************/
+/** \file   telem_decode.c
+ *  \brief  This file reads the binary telemetry from a serial device, a pty
+ *          or a capture file and prints the status frames as CSV.
+ *
+ *  usage: telem_decode <device|file|-> > telem.csv
+ *  A terminal is set to raw 19200 8N1. The decoder resynchronises on the
+ *  next SOF after a bad frame, bad frames and sequence gaps go to stderr.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "crc.h"
+#include "telem.h"
+#include "tstamp.h"
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * open_port()
+ * Opens the input, a terminal is switched to raw mode at 19200 baud.
+-*------------------------------------------------------------------*/
+static int open_port(const char *name)
+{
+    struct termios tio;
+    int fd = strcmp(name, "-") ? open(name, O_RDONLY | O_NOCTTY) : 0;
+
+    if(fd >= 0 && isatty(fd) && tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B19200);
+        cfsetospeed(&tio, B19200);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+/*------------------------------------------------------------------*
+ * get_byte()
+ * Reads one byte, -1 at the end of the input.
+-*------------------------------------------------------------------*/
+static int get_byte(int fd)
+{
+    unsigned char c;
+
+    return (read(fd, &c, 1) == 1) ? c : -1;
+}
+
+/*------------------------------------------------------------------*
+ * print_status()
+ * Prints one TELEM_TYPE_STATUS payload as a CSV line.
+-*------------------------------------------------------------------*/
+static void print_status(const unsigned char *p)
+{
+    unsigned char f = p[TELEM_ST_FLAGS];
+
+    printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+           p[TELEM_ST_SEQ],
+           p[TELEM_ST_TEMP] | (p[TELEM_ST_TEMP + 1] << 8),
+           p[TELEM_ST_AVG] | (p[TELEM_ST_AVG + 1] << 8),
+           p[TELEM_ST_DTEMP],
+           !!(f & TELEM_FLAG_HEATER), !!(f & TELEM_FLAG_COOLER), !!(f & TELEM_FLAG_SET_MODE), !!(f & TELEM_FLAG_SENSOR_FAULT),
+           p[TELEM_ST_ERROR], p[TELEM_ST_OVERRUNS],
+           p[TELEM_ST_WDT_RESETS], p[TELEM_ST_STALLED],
+           p[TELEM_ST_LOAD], p[TELEM_ST_ISR_LOAD],
+           (p[TELEM_ST_PEAK] | (p[TELEM_ST_PEAK + 1] << 8)) * TSTAMP_US_PER_TICK);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char frame[TELEM_MAX_PAYLOAD + TELEM_OVERHEAD];
+    int fd, c, i, seq = -1;
+    unsigned len;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s <device|file|->\n", argv[0]);
+        return 1;
+    }
+    fd = open_port(argv[1]);
+    if(fd < 0)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("seq,temp,avg,dtemp,heater,cooler,set_mode,sensor_fault,sch_error,overruns,wdt_resets,stalled,load,isr_load,peak_us\n");
+    while((c = get_byte(fd)) >= 0)
+    {
+        if(c != TELEM_SOF)
+        {
+            continue;
+        }
+        if((c = get_byte(fd)) < 0)
+        {
+            break;
+        }
+        len = c;
+        if(len == 0 || len > TELEM_MAX_PAYLOAD + 1)
+        {
+            continue;       // not a frame, look for the next SOF
+        }
+        frame[0] = len;
+        for(i = 1 ; i <= (int)len + 1 && (c = get_byte(fd)) >= 0 ; i++)
+        {
+            frame[i] = c;
+        }
+        if(c < 0)
+        {
+            break;
+        }
+        if(crc8(frame, len + 1) != frame[len + 1])
+        {
+            fprintf(stderr, "bad crc\n");
+            continue;
+        }
+        if(frame[1] == TELEM_TYPE_STATUS && len == TELEM_ST_SIZE + 1)
+        {
+            if(seq >= 0 && frame[2 + TELEM_ST_SEQ] != (unsigned char)(seq + 1))
+            {
+                fprintf(stderr, "lost %u frame(s)\n", (unsigned char)(frame[2 + TELEM_ST_SEQ] - seq - 1));
+            }
+            seq = frame[2 + TELEM_ST_SEQ];
+            print_status(&frame[2]);
+        }
+    }
+    return 0;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,137 @@
+/****************************************************************************
+* Title                 :   Event Trace Converter
+* Filename              :   trace2chrome.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Host tool, build with:
+*                           cc -I.. -o trace2chrome trace2chrome.c
+*******************************************************************************/
+/** \file   trace2chrome.c
+ *  \brief  This file converts trace_dump() output (see trace.h) to the Chrome
+ *          trace event JSON format, open it in chrome://tracing or Perfetto.
+ *
+ *  usage: trace2chrome <trace.bin> > trace.json
+ *  Several dumps may be concatenated in the file, each one continues the
+ *  time line of the previous one. The 16 bit time stamps are unwrapped, two
+ *  consecutive events must be less than 262ms apart.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdio.h>
+#include "trace.h"
+#include "tstamp.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+/* One track (tid) per source so the spans nest correctly */
+#define TID_SCH                             1
+#define TID_ISR                             2
+#define TID_ADC                             3
+#define TID_I2C                             4
+#define TID_PWR                             5
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static const char *sep = "";
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * emit()
+ * Prints one trace event named (name) followed by (arg) unless it is
+ * negative, (ph) is "B" / "E" for spans and "i" for instant events.
+-*------------------------------------------------------------------*/
+static void emit(const char *name, int arg, const char *ph, int tid, unsigned long us)
+{
+    printf("%s\n{\"name\":\"%s", sep, name);
+    if(arg >= 0)
+    {
+        printf(" %d", arg);
+    }
+    printf("\",\"ph\":\"%s\",\"ts\":%lu,\"pid\":1,\"tid\":%d%s}",
+           ph, us, tid, (ph[0] == 'i') ? ",\"s\":\"t\"" : "");
+    sep = ",";
+}
+
+/*------------------------------------------------------------------*
+ * convert()
+ * Prints the events of one record.
+-*------------------------------------------------------------------*/
+static void convert(const unsigned char *rec, unsigned long us)
+{
+    switch(rec[0])
+    {
+        case TRACE_TASK_BEGIN:  emit("task", rec[1], "B", TID_SCH, us); break;
+        case TRACE_TASK_END:    emit("task", rec[1], "E", TID_SCH, us); break;
+        case TRACE_EVENT_BEGIN: emit("event", rec[1], "B", TID_SCH, us); break;
+        case TRACE_EVENT_END:   emit("event", rec[1], "E", TID_SCH, us); break;
+        case TRACE_ISR_BEGIN:   emit("isr", -1, "B", TID_ISR, us); break;
+        case TRACE_ISR_END:     emit("isr", -1, "E", TID_ISR, us); break;
+        case TRACE_ADC_BEGIN:   emit("adc ch", rec[1], "B", TID_ADC, us); break;
+        case TRACE_ADC_END:     emit("adc ch", rec[1], "E", TID_ADC, us); break;
+        case TRACE_I2C_BEGIN:   emit("i2c bytes", rec[1], "B", TID_I2C, us); break;
+        case TRACE_I2C_END:     emit("i2c", -1, "E", TID_I2C, us); break;
+        case TRACE_PWR:         emit(rec[1] ? "power on" : "power off", -1, "i", TID_PWR, us); break;
+        default:                emit("id", rec[0], "i", TID_SCH, us); break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    unsigned char rec[TRACE_REC_SIZE];
+    unsigned int ts, last = 0;
+    unsigned long us = 0;
+    int c, n, first = 1, dumps = 0;
+
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <trace.bin>\n", argv[0]);
+        return 1;
+    }
+    fp = fopen(argv[1], "rb");
+    if(fp == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    while((c = fgetc(fp)) != EOF)
+    {
+        /* Resynchronise on the dump header */
+        if(c != TRACE_MAGIC0 || fgetc(fp) != TRACE_MAGIC1 || (n = fgetc(fp)) == EOF)
+        {
+            continue;
+        }
+        dumps++;
+        while(n-- > 0 && fread(rec, 1, TRACE_REC_SIZE, fp) == TRACE_REC_SIZE)
+        {
+            ts = rec[2] | ((unsigned int)rec[3] << 8);
+            if(!first)
+            {
+                us += (unsigned long)((ts - last) & 0xFFFF) * TSTAMP_US_PER_TICK;
+            }
+            first = 0;
+            last = ts;
+            convert(rec, us);
+        }
+    }
+    printf("\n]}\n");
+    fclose(fp);
+
+    if(dumps == 0)
+    {
+        fprintf(stderr, "%s: no trace dump found\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,97 @@
+/****************************************************************************
+* Title                 :   Event Trace
+* Filename              :   trace.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by TRACE_ENABLE in config_EW_Heater.h
+*******************************************************************************/
+/** \file   trace.c
+ *  \brief  This file contains the event trace ring.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "trace.h"
+
+#if TRACE_ENABLE
+#include <xc.h>
+#include "tstamp.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define TRACE_MSK                           (TRACE_BUF_SIZE - 1)
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+static unsigned char trace_buf[TRACE_BUF_SIZE][TRACE_REC_SIZE];
+static unsigned char trace_head = 0;       // next record to write
+static unsigned char trace_cnt = 0;        // records held (<= TRACE_BUF_SIZE)
+static unsigned char trace_paused = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * trace_rec()
+ * The interrupts are held off while a record is written so a record from
+ * the ISR can not interleave with one from a task, the previous GIE state
+ * is restored so it is also safe inside the ISR.
+-*------------------------------------------------------------------*/
+void trace_rec(unsigned char id, unsigned char arg)
+{
+    unsigned char gie = GIE;
+    uint16_t ts;
+    unsigned char *rec;
+
+    GIE = 0;
+    if(trace_paused == 0)
+    {
+        ts = tstamp_get();
+        rec = trace_buf[trace_head];
+        rec[0] = id;
+        rec[1] = arg;
+        rec[2] = (unsigned char)ts;
+        rec[3] = (unsigned char)(ts >> 8);
+        trace_head = (trace_head + 1) & TRACE_MSK;
+        if(trace_cnt < TRACE_BUF_SIZE)
+        {
+            trace_cnt++;
+        }
+    }
+    if(gie)
+    {
+        GIE = 1;
+    }
+}
+
+/*------------------------------------------------------------------*
+ * trace_dump()
+ * This function writes the ring oldest first to (put) and empties it.
+-*------------------------------------------------------------------*/
+void trace_dump(void (*put)(unsigned char))
+{
+    unsigned char i, j, idx;
+
+    trace_paused = 1;
+    put(TRACE_MAGIC0);
+    put(TRACE_MAGIC1);
+    put(trace_cnt);
+    idx = (trace_head - trace_cnt) & TRACE_MSK;
+    for(i = 0 ; i < trace_cnt ; i++)
+    {
+        for(j = 0 ; j < TRACE_REC_SIZE ; j++)
+        {
+            put(trace_buf[idx][j]);
+        }
+        idx = (idx + 1) & TRACE_MSK;
+    }
+    trace_cnt = 0;
+    trace_paused = 0;
+}
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,96 @@
+/****************************************************************************
+* Title                 :   Event Trace
+* Filename              :   trace.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Enabled by TRACE_ENABLE in config_EW_Heater.h
+*******************************************************************************/
+/** \file   trace.h
+ *  \brief  This file contains the event tracer. Every TRACE() point records
+ *          an event number, an argument and a Timer 1 time stamp in a RAM
+ *          ring, the oldest events are overwritten (flight recorder).
+ *          With TRACE_ENABLE 0 the TRACE() points compile to nothing.
+ *
+ *  Dump format (trace_dump()): TRACE_MAGIC0, TRACE_MAGIC1, the number of
+ *  records, then the records oldest first, each one:
+ *      id, arg, time stamp low byte, time stamp high byte
+ *  The time stamp is in TSTAMP_US_PER_TICK units and wraps every 262ms.
+ *  tools/trace2chrome converts a dump to the Chrome trace JSON format.
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define TRACE_MAGIC0                        'T'
+#define TRACE_MAGIC1                        'R'
+#define TRACE_REC_SIZE                      4
+
+/*****************************************************************************
+ *
+ *  Trace events, the _BEGIN / _END pairs are spans with the same argument
+ *
+ *****************************************************************************/
+#define TRACE_TASK_BEGIN                    0x01    // arg: task index
+#define TRACE_TASK_END                      0x02
+#define TRACE_EVENT_BEGIN                   0x03    // arg: event number
+#define TRACE_EVENT_END                     0x04
+#define TRACE_ISR_BEGIN                     0x05    // arg: 0
+#define TRACE_ISR_END                       0x06
+#define TRACE_ADC_BEGIN                     0x07    // arg: channel
+#define TRACE_ADC_END                       0x08
+#define TRACE_I2C_BEGIN                     0x09    // arg: length
+#define TRACE_I2C_END                       0x0A
+#define TRACE_PWR                           0x0B    // arg: PWR_MOD_T entered
+/*****************************************************************************/
+
+#if TRACE_ENABLE
+#define TRACE(id, arg)                      trace_rec((id), (arg))
+#else
+#define TRACE(id, arg)
+#endif
+
+#if TRACE_ENABLE && TRACE_ISR
+#define TRACE_IN_ISR(id, arg)               trace_rec((id), (arg))
+#else
+#define TRACE_IN_ISR(id, arg)
+#endif
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * trace_rec()
+ *
+ * @brief This function records an event, it can be called from the ISR and
+ *        from the tasks. Use the TRACE() macro so the call compiles out.
+ *
+ * @param <unsigned char id> the TRACE_xxx event
+ * @param <unsigned char arg> the event argument
+ * @return <void>
+ */
+void trace_rec(unsigned char id, unsigned char arg);
+
+/**
+ * trace_dump()
+ *
+ * @brief This function writes the ring oldest first to a byte sink (the
+ *        USART or a file on the host build) and empties it. Recording is
+ *        paused while dumping.
+ *
+ * @param <void (*put)(unsigned char)> the byte sink
+ * @return <void>
+ */
+void trace_dump(void (*put)(unsigned char));
+
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,52 @@
+/****************************************************************************
+* Title                 :   Time Stamp
+* Filename              :   tstamp.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Uses Timer 1, free running
+*******************************************************************************/
+/** \file   tstamp.c
+ *  \brief  This file contains the Timer 1 free running time base.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <xc.h>
+#include "tstamp.h"
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * tstamp_init()
+ * Timer 1 on, prescaler 8, internal clock, no interrupt.
+-*------------------------------------------------------------------*/
+void tstamp_init(void)
+{
+    T1CON = 0x30;
+    TMR1H = 0;
+    TMR1L = 0;
+    TMR1IE = 0;
+    TMR1ON = 1;
+}
+
+/*------------------------------------------------------------------*
+ * tstamp_get()
+ * The two bytes are read separately, the high byte is read again and the
+ * read is repeated if the low byte rolled over in between.
+-*------------------------------------------------------------------*/
+uint16_t tstamp_get(void)
+{
+    unsigned char hi, lo;
+
+    do
+    {
+        hi = TMR1H;
+        lo = TMR1L;
+    } while(hi != TMR1H);
+    return ((uint16_t)hi << 8) | lo;
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,56 @@
+/****************************************************************************
+* Title                 :   Time Stamp
+* Filename              :   tstamp.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Uses Timer 1, free running
+*******************************************************************************/
+/** \file   tstamp.h
+ *  \brief  This file contains a free running microsecond time base used to
+ *          measure short intervals (it wraps every 262ms, take differences).
+ *          Timer 1 runs from the instruction clock, it stops in sleep mode.
+ */
+
+#ifndef __TSTAMP_H__
+#define __TSTAMP_H__
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include <stdint.h>
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define TSTAMP_US_PER_TICK                  4       // 2MHz instruction clock, prescaler 8
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * tstamp_init()
+ *
+ * @brief This function starts Timer 1 with a 1:8 prescaler from the
+ *        instruction clock, its interrupt is not used.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void tstamp_init(void);
+
+/**
+ * tstamp_get()
+ *
+ * @brief This function reads the time base, can be called from the ISR.
+ *        The time wraps at 16 bits, differences are taken in uint16_t so
+ *        they wrap the same way on the host tools.
+ *
+ * @param <void> takes no arguments
+ * @return <uint16_t> the time in TSTAMP_US_PER_TICK units
+ */
+uint16_t tstamp_get(void);
+
+#endif
+/*** End of File **************************************************************/
@@ -0,0 +1,147 @@
+/****************************************************************************
+* Title                 :   USART
+* Filename              :   usart.c
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Baud rate and ring sizes can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   usart.c
+ *  \brief  This file contains the interrupt driven USART driver.
+ */
+
+/******************************************************************************
+* Includes
+*******************************************************************************/
+#include "config_EW_Heater.h"
+#include "usart.h"
+#include "port.h"
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define USART_TX_MSK                        (USART_TX_SIZE - 1)
+#define USART_RX_MSK                        (USART_RX_SIZE - 1)
+
+/******************************************************************************
+* Variables
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * Single producer / single consumer rings: the task side only writes
+ * the TX head and the RX tail, the ISR side only the TX tail and the RX
+ * head, so no locking is needed (one slot is kept free).
+-*------------------------------------------------------------------*/
+static unsigned char usart_tx_buf[USART_TX_SIZE];
+static volatile unsigned char usart_tx_head = 0;
+static volatile unsigned char usart_tx_tail = 0;
+static unsigned char usart_rx_buf[USART_RX_SIZE];
+static volatile unsigned char usart_rx_head = 0;
+static volatile unsigned char usart_rx_tail = 0;
+
+/******************************************************************************
+* Functions
+*******************************************************************************/
+/*------------------------------------------------------------------*
+ * usart_init()
+ * 8N1 asynchronous, high speed baud rate generator.
+-*------------------------------------------------------------------*/
+void usart_init(void)
+{
+    USART_IO_REG |= USART_PINS_MSK;
+    SPBRG = USART_SPBRG;
+    TXSTA = 0x24;               // TXEN, BRGH, asynchronous 8 bit
+    RCSTA = 0x90;               // SPEN, CREN, 8 bit
+    usart_tx_head = usart_tx_tail = 0;
+    usart_rx_head = usart_rx_tail = 0;
+    TXIE = 0;                   // enabled when there is something to send
+    RCIE = 1;
+}
+
+/*------------------------------------------------------------------*
+ * usart_write()
+ * All the bytes are queued or none, the head is moved once after the
+ * copy so the ISR never sends a partial frame.
+-*------------------------------------------------------------------*/
+unsigned char usart_write(const unsigned char *buf, unsigned char len)
+{
+    unsigned char head = usart_tx_head;
+    unsigned char room = (usart_tx_tail - head - 1) & USART_TX_MSK;
+
+    if(len > room)
+    {
+        return USART_BUSY;
+    }
+    while(len--)
+    {
+        usart_tx_buf[head] = *buf++;
+        head = (head + 1) & USART_TX_MSK;
+    }
+    usart_tx_head = head;
+    TXIE = 1;
+    return USART_OK;
+}
+
+/*------------------------------------------------------------------*
+ * usart_putc()
+ * This function queues one byte, waiting while the ring is full.
+-*------------------------------------------------------------------*/
+void usart_putc(unsigned char c)
+{
+    while(usart_write(&c, 1) != USART_OK);
+}
+
+/*------------------------------------------------------------------*
+ * usart_getc()
+ * This function takes one received byte from the RX ring.
+-*------------------------------------------------------------------*/
+unsigned char usart_getc(unsigned char *c)
+{
+    if(usart_rx_tail == usart_rx_head)
+    {
+        return 0;
+    }
+    *c = usart_rx_buf[usart_rx_tail];
+    usart_rx_tail = (usart_rx_tail + 1) & USART_RX_MSK;
+    return 1;
+}
+
+/*------------------------------------------------------------------*
+ * usart_tx_isr()
+ * TXIF stays set while TXREG is empty, the interrupt is turned off once
+ * the ring is empty and turned on again by usart_write().
+-*------------------------------------------------------------------*/
+void usart_tx_isr(void)
+{
+    if(usart_tx_tail == usart_tx_head)
+    {
+        TXIE = 0;
+        return;
+    }
+    TXREG = usart_tx_buf[usart_tx_tail];
+    usart_tx_tail = (usart_tx_tail + 1) & USART_TX_MSK;
+}
+
+/*------------------------------------------------------------------*
+ * usart_rx_isr()
+ * Reading RCREG clears RCIF, an overrun stops the receiver until CREN is
+ * toggled.
+-*------------------------------------------------------------------*/
+void usart_rx_isr(void)
+{
+    unsigned char c, next;
+
+    if(OERR)
+    {
+        CREN = 0;
+        CREN = 1;
+    }
+    c = RCREG;
+    next = (usart_rx_head + 1) & USART_RX_MSK;
+    if(next != usart_rx_tail)
+    {
+        usart_rx_buf[usart_rx_head] = c;
+        usart_rx_head = next;
+    }
+}
+/*** End of File **************************************************************/
@@ -0,0 +1,95 @@
+/****************************************************************************
+* Title                 :   USART
+* Filename              :   usart.h
+* Author                :   Muhammed Elkomy
+* Origin Date           :   08/07/2020
+* Version               :   1.0.0
+*
+* Notes                 :   Baud rate and ring sizes can be configured from config_EW_Heater.h
+*******************************************************************************/
+/** \file   usart.h
+ *  \brief  This file contains the interrupt driven asynchronous USART driver.
+ *          The tasks only copy bytes to / from the TX and RX rings, the
+ *          TXIF / RCIF interrupts move them to / from the USART.
+ */
+
+#ifndef __USART_H__
+#define __USART_H__
+
+/******************************************************************************
+* Constants
+*******************************************************************************/
+#define USART_OK                            0
+#define USART_BUSY                          1
+
+/******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+/**
+ * usart_init()
+ *
+ * @brief This function initializes the USART (8N1, USART_SPBRG with BRGH = 1)
+ *        and enables the receive interrupt.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void usart_init(void);
+
+/**
+ * usart_write()
+ *
+ * @brief This function queues (len) bytes for transmission, all of them or
+ *        none so a frame is never cut. It does not wait.
+ *
+ * @param <const unsigned char *buf> the data to send
+ * @param <unsigned char len> the number of bytes
+ * @return <unsigned char> USART_OK or USART_BUSY if the TX ring has no room
+ */
+unsigned char usart_write(const unsigned char *buf, unsigned char len);
+
+/**
+ * usart_putc()
+ *
+ * @brief This function queues one byte, it waits while the TX ring is full
+ *        (for diagnostic dumps, not for the periodic tasks).
+ *
+ * @param <unsigned char c> the byte to send
+ * @return <void>
+ */
+void usart_putc(unsigned char c);
+
+/**
+ * usart_getc()
+ *
+ * @brief This function takes one received byte from the RX ring.
+ *
+ * @param <unsigned char *c> the byte read
+ * @return <unsigned char> 1 if a byte was read, 0 if the RX ring is empty
+ */
+unsigned char usart_getc(unsigned char *c);
+
+/**
+ * usart_tx_isr()
+ *
+ * @brief This function is called by the TXIF interrupt, it moves the next
+ *        byte of the TX ring to TXREG and disables the interrupt when empty.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void usart_tx_isr(void);
+
+/**
+ * usart_rx_isr()
+ *
+ * @brief This function is called by the RCIF interrupt, it moves the
+ *        received byte to the RX ring (dropped if full) and clears an overrun.
+ *
+ * @param <void> takes no arguments
+ * @return <void>
+ */
+void usart_rx_isr(void);
+
+#endif
+/*** End of File **************************************************************/